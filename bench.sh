@@ -0,0 +1,30 @@
+echo Building...
+mkdir -p build
+
+# `./bench.sh cpp` runs the C++ front end against the C parser instead
+if [ "$1" = "cpp" ]; then
+    shift
+    if cc -O2 -Wall -I. $CFLAGS -c -x c -DCLI_PARSER_IMPLEMENTATION -o build/cli-parser.o cli-parser.h \
+        && c++ -std=c++20 -O2 -Wall -I. $CFLAGS -o build/bench_cpp.elf bench/bench_cpp.cpp build/cli-parser.o; then
+        true
+    else
+        echo Build failed.
+        exit 1
+    fi
+    echo Running...
+    ./build/bench_cpp.elf "$@"
+    exit $?
+fi
+
+# the first build writes the parsers `cp_generateParser` makes for the bench tables, the second one links them in
+if cc -O2 -Wall -I. -pthread $CFLAGS -o build/bench.elf bench/bench.c \
+    && ./build/bench.elf --generate=build/bench_generated.c \
+    && cc -O2 -Wall -I. -pthread $CFLAGS -DCP_BENCH_GENERATED -o build/bench.elf bench/bench.c build/bench_generated.c; then
+    true
+else 
+    echo Build failed.
+    exit 1
+fi
+
+echo Running...
+./build/bench.elf "$@"
@@ -0,0 +1,1507 @@
+// Benchmark suite for the parser hot paths.
+// Every case builds a synthetic argv and option table, then reports ns, instructions and allocations per token.
+// Results are also written to a tab separated file so two runs can be compared with `--compare old new`.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+static long alloc_count = 0;
+static void *counting_calloc(size_t count, size_t size) {
+    ++alloc_count;
+    return calloc(count, size);
+}
+static void *counting_realloc(void *ptr, size_t size) {
+    ++alloc_count;
+    return realloc(ptr, size);
+}
+
+#define CP_CALLOC counting_calloc
+#define CP_REALLOC counting_realloc
+#define CP_ENABLE_BATCH
+#define CP_ENABLE_CODEGEN
+#define CLI_PARSER_IMPLEMENTATION
+#include "cli-parser.h"
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+static double now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+// xorshift, deterministic so every run parses the same argv
+static uint32_t rng_state = 2463534242u;
+static uint32_t rng(void) {
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 17;
+    rng_state ^= rng_state << 5;
+    return rng_state;
+}
+
+// ---- instruction counter ----
+
+static int perf_fd = -1;
+static void counter_init(void) {
+#ifdef __linux__
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.size = sizeof(attr);
+    attr.config = PERF_COUNT_HW_INSTRUCTIONS;
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    perf_fd = (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+#endif
+}
+static void counter_start(void) {
+#ifdef __linux__
+    if(perf_fd < 0) return;
+    ioctl(perf_fd, PERF_EVENT_IOC_RESET, 0);
+    ioctl(perf_fd, PERF_EVENT_IOC_ENABLE, 0);
+#endif
+}
+// -1 when hardware counters are not available
+static long long counter_stop(void) {
+#ifdef __linux__
+    if(perf_fd < 0) return -1;
+    ioctl(perf_fd, PERF_EVENT_IOC_DISABLE, 0);
+    long long count;
+    if(read(perf_fd, &count, sizeof(count)) != sizeof(count)) return -1;
+    return count;
+#else
+    return -1;
+#endif
+}
+
+// ---- workloads ----
+
+typedef struct {
+    Cp_Opt *optv;
+    void *holders;
+    char **names;
+    int optc;
+} Opt_Table;
+
+static const char short_names[] = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789";
+#define SHORT_NAMEC ((int)sizeof(short_names)-1)
+
+// Options named `option-number-N` of `kind`. The short names go to the last options
+// so the linear scan has to walk the whole table to find them.
+static Opt_Table make_opts(int optc, Cp_Opt_Kind kind) {
+    Opt_Table table = {0};
+    table.optc = optc;
+    table.optv = calloc(optc, sizeof(Cp_Opt));
+    table.holders = calloc(optc, sizeof(Cp_Value));
+    table.names = calloc(optc, sizeof(char*));
+    for(int i = 0; i < optc; ++i) {
+        table.names[i] = malloc(32);
+        snprintf(table.names[i], 32, "option-number-%d", i);
+        int from_end = optc-1-i;
+        char short_name = from_end < SHORT_NAMEC ? short_names[from_end] : 0;
+        Cp_Opt opt = {(Cp_Value*)table.holders + i, kind, table.names[i], short_name, "Synthetic option."};
+        memcpy(&table.optv[i], &opt, sizeof(opt));
+    }
+    return table;
+}
+static void free_opts(Opt_Table table) {
+    for(int i = 0; i < table.optc; ++i) {
+        free(table.names[i]);
+    }
+    free(table.names);
+    free(table.holders);
+    free(table.optv);
+}
+
+typedef struct {
+    char **argv;
+    int argc;
+} Argv;
+static Argv argv_new(int cap) {
+    Argv a = {calloc(cap+1, sizeof(char*)), 1};
+    a.argv[0] = "bench";
+    return a;
+}
+static void argv_push(Argv *a, const char *str) {
+    a->argv[a->argc] = malloc(strlen(str)+1);
+    strcpy(a->argv[a->argc++], str);
+}
+static void argv_free(Argv a) {
+    for(int i = 1; i < a.argc; ++i) {
+        free(a.argv[i]);
+    }
+    free(a.argv);
+}
+
+typedef enum {
+    FORM_FLAG,   // --name
+    FORM_EQUALS, // --name=value
+    FORM_COLON,  // --name:value
+    FORM_SPACE,  // --name value
+} Value_Form;
+static const char *form_names[] = {"flag", "equals", "colon", "space"};
+
+static Argv make_long_argv(Opt_Table table, int tokens, Value_Form form, bool numeric) {
+    Argv a = argv_new(tokens);
+    char buf[64];
+    while(a.argc < tokens) {
+        const char *name = table.names[rng() % table.optc];
+        const char *value = numeric ? "12345" : "some/value.txt";
+        switch(form) {
+            case FORM_FLAG: snprintf(buf, sizeof(buf), "--%s", name); break;
+            case FORM_EQUALS: snprintf(buf, sizeof(buf), "--%s=%s", name, value); break;
+            case FORM_COLON: snprintf(buf, sizeof(buf), "--%s:%s", name, value); break;
+            case FORM_SPACE: {
+                if(a.argc+1 >= tokens) {
+                    argv_push(&a, "positional.c");
+                    continue;
+                }
+                snprintf(buf, sizeof(buf), "--%s", name);
+                argv_push(&a, buf);
+                snprintf(buf, sizeof(buf), "%s", value);
+            } break;
+        }
+        argv_push(&a, buf);
+    }
+    return a;
+}
+
+// clusters like `-xvzf` with `cluster` flags each, or `-x value` when `form` takes a value
+static Argv make_short_argv(Opt_Table table, int tokens, int cluster, Value_Form form) {
+    int count = SHORT_NAMEC < table.optc ? SHORT_NAMEC : table.optc;
+    Argv a = argv_new(tokens);
+    char buf[64];
+    while(a.argc < tokens) {
+        char short_name = short_names[rng() % count];
+        switch(form) {
+            case FORM_FLAG: {
+                buf[0] = '-';
+                for(int j = 0; j < cluster; ++j) {
+                    buf[j+1] = short_names[rng() % count];
+                }
+                buf[cluster+1] = '\0';
+            } break;
+            case FORM_EQUALS: snprintf(buf, sizeof(buf), "-%c=value", short_name); break;
+            case FORM_COLON: snprintf(buf, sizeof(buf), "-%c:value", short_name); break;
+            case FORM_SPACE: {
+                if(a.argc+1 >= tokens) {
+                    argv_push(&a, "positional.c");
+                    continue;
+                }
+                snprintf(buf, sizeof(buf), "-%c", short_name);
+                argv_push(&a, buf);
+                snprintf(buf, sizeof(buf), "value");
+            } break;
+        }
+        argv_push(&a, buf);
+    }
+    return a;
+}
+
+static Argv make_positional_argv(int tokens) {
+    Argv a = argv_new(tokens);
+    char buf[32];
+    while(a.argc < tokens) {
+        snprintf(buf, sizeof(buf), "src/file-%u.c", rng() % 100000);
+        argv_push(&a, buf);
+    }
+    return a;
+}
+
+// ---- measuring ----
+
+typedef struct {
+    char name[96];
+    double ns_per_token;
+    double instructions_per_token; // negative when unavailable
+    double allocations; // per parse, including the context itself
+} Result;
+
+static Result *results = NULL;
+static int resultc = 0;
+static int resultcap = 0;
+static const char *filter = NULL;
+static bool quick = false;
+
+static void record(Result result) {
+    if(resultc == resultcap) {
+        resultcap = resultcap ? resultcap*2 : 64;
+        results = realloc(results, resultcap * sizeof(Result));
+    }
+    results[resultc++] = result;
+    if(result.instructions_per_token >= 0) {
+        printf("  %-52s %10.1f ns/token %10.1f instr/token %6.1f allocs\n",
+            result.name, result.ns_per_token, result.instructions_per_token, result.allocations);
+    } else {
+        printf("  %-52s %10.1f ns/token %16s %6.1f allocs\n",
+            result.name, result.ns_per_token, "n/a", result.allocations);
+    }
+    fflush(stdout);
+}
+
+static bool wanted(const char *name) {
+    return filter == NULL || strstr(name, filter) != NULL;
+}
+
+typedef struct {
+    Opt_Table table;
+    const Cp_Schema *schema;
+    const Cp_SubcmdSet *set;
+    uintmax_t subcommandc;
+    const char **subcommandv;
+    Argv argv;
+    char **argumentv;
+    bool stack_ctx; // uses `cp_initCtx` on the stack instead of `cp_newCtx`
+    bool bits;      // marks arguments in `argument_bits` instead of copying them to `argumentv`
+    uint64_t *argument_bits;
+    // parser from `cp_generateParser` to use instead of `cp_parseUntil`
+    int (*generated)(Cp_Ctx *ctx, uintmax_t subcommandc, const char *subcommandv[]);
+    const Cp_Rules *rules;
+} Parse_Job;
+
+static void parse_once(Parse_Job *job) {
+    Cp_Ctx storage;
+    Cp_Ctx *ctx = &storage;
+    if(job->stack_ctx) {
+        cp_initCtx(ctx, job->argv.argc, job->argv.argv, job->table.optc, job->table.optv, job->argv.argc, job->argumentv);
+    } else {
+        ctx = cp_newCtx(job->argv.argc, job->argv.argv, job->table.optc, job->table.optv, job->argv.argc, job->argumentv);
+    }
+    ctx->schema = job->schema;
+    ctx->rules = job->rules;
+    if(job->bits) {
+        ctx->argument_bits = job->argument_bits;
+    }
+    int stopped;
+    if(job->set != NULL) {
+        stopped = cp_parseUntilSet(ctx, job->set);
+    } else if(job->generated != NULL) {
+        stopped = job->generated(ctx, job->subcommandc, job->subcommandv);
+    } else {
+        stopped = cp_parseUntil(ctx, job->subcommandc, job->subcommandv);
+    }
+    if(stopped != job->argv.argc) {
+        char err[256];
+        cp_formatError(ctx, err, sizeof(err));
+        fprintf(stderr, "bench: parse stopped at %d: %s\n", stopped, err);
+        exit(1);
+    }
+    if(!job->stack_ctx) {
+        cp_freeCtx(ctx);
+    }
+    // lists would keep growing from one round to the next
+    for(int i = 0; i < job->table.optc; ++i) {
+        Cp_Opt_Kind kind = job->table.optv[i].kind;
+        if(kind == OPTK_STRING_LIST || kind == OPTK_NUMBER_LIST) {
+            cp_freeList(job->table.optv[i].holder);
+        }
+    }
+}
+
+// Runs the job until roughly `budget_ns` elapsed, keeping the best time.
+static void measure(const char *name, Parse_Job *job) {
+    if(!wanted(name)) return;
+    job->argumentv = malloc(job->argv.argc * sizeof(char*));
+    job->argument_bits = malloc(CP_ARGUMENT_WORDS(job->argv.argc) * sizeof(uint64_t));
+    double budget_ns = quick ? 2e7 : 2e8;
+    double best = 1e300;
+    double spent = 0;
+    long rounds = 0;
+    long allocs = 0;
+    long long instructions = -1;
+    while(rounds < 3 || (spent < budget_ns && rounds < 1000)) {
+        long allocs_before = alloc_count;
+        counter_start();
+        double start = now_ns();
+        parse_once(job);
+        double elapsed = now_ns() - start;
+        long long counted = counter_stop();
+        allocs = alloc_count - allocs_before;
+        if(elapsed < best) {
+            best = elapsed;
+            instructions = counted;
+        }
+        spent += elapsed;
+        ++rounds;
+    }
+    free(job->argumentv);
+    free(job->argument_bits);
+
+    Result result;
+    snprintf(result.name, sizeof(result.name), "%s", name);
+    result.ns_per_token = best / job->argv.argc;
+    result.instructions_per_token = instructions >= 0 ? (double)instructions / job->argv.argc : -1;
+    result.allocations = (double)allocs;
+    record(result);
+}
+
+// ---- cases ----
+
+static void bench_long(void) {
+    printf("long options:\n");
+    const int optcs[] = {10, 100, 1000, 10000};
+    const int tokenss[] = {10, 1000, 100000, 1000000};
+    char name[96];
+    // scaling with the option table
+    for(size_t i = 0; i < sizeof(optcs)/sizeof(*optcs); ++i) {
+        int tokens = quick ? 10000 : 100000;
+        Opt_Table table = make_opts(optcs[i], OPTK_BOOL);
+        Cp_Schema *schema = cp_compileOpts(table.optc, table.optv);
+        Parse_Job job = {table, NULL, NULL, 0, NULL, make_long_argv(table, tokens, FORM_FLAG, false)};
+        // the linear scan is too slow to repeat on big products
+        if((double)optcs[i] * tokens <= 1e8) {
+            snprintf(name, sizeof(name), "long/flag/linear/opts=%d/tokens=%d", optcs[i], tokens);
+            measure(name, &job);
+        }
+        job.schema = schema;
+        snprintf(name, sizeof(name), "long/flag/schema/opts=%d/tokens=%d", optcs[i], tokens);
+        measure(name, &job);
+        argv_free(job.argv);
+        cp_freeSchema(schema);
+        free_opts(table);
+    }
+    // scaling with argv
+    for(size_t i = 0; i < sizeof(tokenss)/sizeof(*tokenss); ++i) {
+        if(quick && tokenss[i] > 100000) continue;
+        Opt_Table table = make_opts(100, OPTK_BOOL);
+        Cp_Schema *schema = cp_compileOpts(table.optc, table.optv);
+        Parse_Job job = {table, schema, NULL, 0, NULL, make_long_argv(table, tokenss[i], FORM_FLAG, false)};
+        snprintf(name, sizeof(name), "long/flag/schema/opts=100/tokens=%d", tokenss[i]);
+        measure(name, &job);
+        argv_free(job.argv);
+        cp_freeSchema(schema);
+        free_opts(table);
+    }
+    // short command lines, where setting the context up is a big part of the cost
+    for(int stack_ctx = 0; stack_ctx < 2; ++stack_ctx) {
+        Opt_Table table = make_opts(100, OPTK_BOOL);
+        Cp_Schema *schema = cp_compileOpts(table.optc, table.optv);
+        Parse_Job job = {table, schema, NULL, 0, NULL, make_long_argv(table, 8, FORM_FLAG, false)};
+        job.stack_ctx = stack_ctx;
+        snprintf(name, sizeof(name), "long/flag/schema/%s/opts=100/tokens=8", stack_ctx ? "stack-ctx" : "heap-ctx");
+        measure(name, &job);
+        argv_free(job.argv);
+        cp_freeSchema(schema);
+        free_opts(table);
+    }
+    // value forms
+    for(int form = FORM_EQUALS; form <= FORM_SPACE; ++form) {
+        for(int numeric = 0; numeric < 2; ++numeric) {
+            Opt_Table table = make_opts(100, numeric ? OPTK_INT64 : OPTK_STRING);
+            Cp_Schema *schema = cp_compileOpts(table.optc, table.optv);
+            Parse_Job job = {table, schema, NULL, 0, NULL, make_long_argv(table, 100000, form, numeric)};
+            snprintf(name, sizeof(name), "long/%s/%s/opts=100/tokens=100000", form_names[form], numeric ? "int64" : "string");
+            measure(name, &job);
+            argv_free(job.argv);
+            cp_freeSchema(schema);
+            free_opts(table);
+        }
+    }
+    // `--define=...` with big values, which should cost the same as small ones
+    const int value_bytes[] = {16, 4096};
+    for(size_t i = 0; i < sizeof(value_bytes)/sizeof(*value_bytes); ++i) {
+        int tokens = quick ? 1000 : 10000;
+        Opt_Table table = make_opts(100, OPTK_STRING);
+        Cp_Schema *schema = cp_compileOpts(table.optc, table.optv);
+        Argv a = argv_new(tokens);
+        char *buf = malloc(64 + value_bytes[i]);
+        while(a.argc < tokens) {
+            int at = snprintf(buf, 64, "--%s=", table.names[rng() % table.optc]);
+            memset(buf + at, 'x', value_bytes[i]);
+            buf[at + value_bytes[i]] = '\0';
+            argv_push(&a, buf);
+        }
+        free(buf);
+        Parse_Job job = {table, schema, NULL, 0, NULL, a};
+        snprintf(name, sizeof(name), "long/equals/string/opts=100/value-bytes=%d", value_bytes[i]);
+        measure(name, &job);
+        argv_free(job.argv);
+        cp_freeSchema(schema);
+        free_opts(table);
+    }
+}
+
+static void bench_short(void) {
+    printf("short options:\n");
+    const int optcs[] = {10, 100, 1000, 10000};
+    const int clusters[] = {1, 4, 8};
+    const int tokens = quick ? 10000 : 100000;
+    char name[96];
+    for(size_t i = 0; i < sizeof(optcs)/sizeof(*optcs); ++i) {
+        for(size_t c = 0; c < sizeof(clusters)/sizeof(*clusters); ++c) {
+            Opt_Table table = make_opts(optcs[i], OPTK_BOOL);
+            Cp_Schema *schema = cp_compileOpts(table.optc, table.optv);
+            Parse_Job job = {table, NULL, NULL, 0, NULL, make_short_argv(table, tokens, clusters[c], FORM_FLAG)};
+            if((double)optcs[i] * tokens * clusters[c] <= 1e8) {
+                snprintf(name, sizeof(name), "short/cluster=%d/linear/opts=%d/tokens=%d", clusters[c], optcs[i], tokens);
+                measure(name, &job);
+            }
+            job.schema = schema;
+            snprintf(name, sizeof(name), "short/cluster=%d/schema/opts=%d/tokens=%d", clusters[c], optcs[i], tokens);
+            measure(name, &job);
+            argv_free(job.argv);
+            cp_freeSchema(schema);
+            free_opts(table);
+        }
+    }
+    for(int form = FORM_EQUALS; form <= FORM_SPACE; ++form) {
+        Opt_Table table = make_opts(100, OPTK_STRING);
+        Cp_Schema *schema = cp_compileOpts(table.optc, table.optv);
+        Parse_Job job = {table, schema, NULL, 0, NULL, make_short_argv(table, tokens, 1, form)};
+        snprintf(name, sizeof(name), "short/%s/string/opts=100/tokens=%d", form_names[form], tokens);
+        measure(name, &job);
+        argv_free(job.argv);
+        cp_freeSchema(schema);
+        free_opts(table);
+    }
+}
+
+static void bench_positionals(void) {
+    printf("positional arguments:\n");
+    const int tokenss[] = {1000, 200000};
+    char name[96];
+    Opt_Table table = make_opts(10, OPTK_BOOL);
+    for(size_t i = 0; i < sizeof(tokenss)/sizeof(*tokenss); ++i) {
+        Parse_Job job = {table, NULL, NULL, 0, NULL, make_positional_argv(tokenss[i])};
+        snprintf(name, sizeof(name), "positional/argumentv/tokens=%d", tokenss[i]);
+        measure(name, &job);
+        job.bits = true;
+        snprintf(name, sizeof(name), "positional/bits/tokens=%d", tokenss[i]);
+        measure(name, &job);
+        argv_free(job.argv);
+    }
+    free_opts(table);
+}
+
+static void bench_subcommands(void) {
+    printf("subcommands:\n");
+    const int subcommandcs[] = {10, 120, 1000};
+    const int tokens = quick ? 10000 : 100000;
+    char name[96];
+    Opt_Table table = make_opts(10, OPTK_BOOL);
+    Argv argv = make_positional_argv(tokens);
+    for(size_t i = 0; i < sizeof(subcommandcs)/sizeof(*subcommandcs); ++i) {
+        int subcommandc = subcommandcs[i];
+        const char **subcommandv = calloc(subcommandc, sizeof(char*));
+        for(int j = 0; j < subcommandc; ++j) {
+            char *subcommand = malloc(32);
+            snprintf(subcommand, 32, "subcommand-%d", j);
+            subcommandv[j] = subcommand;
+        }
+        Cp_SubcmdSet *set = cp_compileSubcommands(subcommandc, subcommandv);
+        Parse_Job job = {table, NULL, NULL, subcommandc, subcommandv, argv};
+        snprintf(name, sizeof(name), "subcommands/array/count=%d/tokens=%d", subcommandc, tokens);
+        measure(name, &job);
+        job.set = set;
+        snprintf(name, sizeof(name), "subcommands/set/count=%d/tokens=%d", subcommandc, tokens);
+        measure(name, &job);
+        cp_freeSubcommands(set);
+        for(int j = 0; j < subcommandc; ++j) {
+            free((char*)subcommandv[j]);
+        }
+        free(subcommandv);
+    }
+    argv_free(argv);
+    free_opts(table);
+}
+
+static void bench_numbers(void) {
+    printf("number conversion:\n");
+    const char *literals[] = {"0", "42", "3.14159", "-17.5", "1e9", "0.000125", "123456.789", "6.02214076e23"};
+    const int literalc = sizeof(literals)/sizeof(*literals);
+    const int rounds = quick ? 100000 : 1000000;
+    size_t lens[sizeof(literals)/sizeof(*literals)];
+    for(int i = 0; i < literalc; ++i) {
+        lens[i] = strlen(literals[i]);
+    }
+
+    // the sum keeps the compiler from dropping the conversions
+    volatile double sum = 0;
+    for(int which = 0; which < 3; ++which) {
+        const char *names[] = {"numbers/sscanf-double", "numbers/cp__parseDouble", "numbers/cp__parseInt64"};
+        if(!wanted(names[which])) continue;
+        counter_start();
+        double start = now_ns();
+        for(int r = 0; r < rounds; ++r) {
+            int i = r % literalc;
+            if(which == 0) {
+                double value;
+                if(sscanf(literals[i], "%lf", &value) == 1) sum += value;
+            } else if(which == 1) {
+                double value;
+                if(cp__parseDouble(literals[i], lens[i], &value) == CP__NUM_OK) sum += value;
+            } else {
+                int64_t value;
+                if(cp__parseInt64(literals[r % 2], lens[r % 2], &value) == CP__NUM_OK) sum += (double)value;
+            }
+        }
+        double elapsed = now_ns() - start;
+        long long instructions = counter_stop();
+        Result result;
+        snprintf(result.name, sizeof(result.name), "%s", names[which]);
+        result.ns_per_token = elapsed / rounds;
+        result.instructions_per_token = instructions >= 0 ? (double)instructions / rounds : -1;
+        result.allocations = 0;
+        record(result);
+    }
+}
+
+// an environment of `varc` variables, of which `optc` back an option
+static void bench_env(void) {
+    printf("environment:\n");
+    const int optcs[] = {10, 100, 1000};
+    const int varc = 1000;
+    const int rounds = quick ? 200 : 2000;
+    char name[96];
+    char **envp = calloc(varc + 1, sizeof(char*));
+    for(int i = 0; i < varc; ++i) {
+        envp[i] = malloc(48);
+        snprintf(envp[i], 48, "SOME_SERVICE_SETTING_%d=%d", i, i);
+    }
+    for(size_t k = 0; k < sizeof(optcs)/sizeof(*optcs); ++k) {
+        int optc = optcs[k];
+        Opt_Table table = make_opts(optc, OPTK_INT64);
+        char **envs = calloc(optc, sizeof(char*));
+        for(int i = 0; i < optc; ++i) {
+            envs[i] = malloc(48);
+            // spread over the environment, the last ones being missing
+            snprintf(envs[i], 48, "SOME_SERVICE_SETTING_%d", (int)((long)i * varc * 2 / optc));
+            table.optv[i].env = envs[i];
+        }
+        Cp_Schema *schema = cp_compileOpts(table.optc, table.optv);
+        char *argv[] = {"bench", NULL};
+        for(int hashed = 0; hashed < 2; ++hashed) {
+            snprintf(name, sizeof(name), "env/%s/opts=%d/vars=%d", hashed ? "schema" : "linear", optc, varc);
+            if(!wanted(name)) continue;
+            Cp_Ctx ctx;
+            cp_initCtx(&ctx, 1, argv, table.optc, table.optv, 0, NULL);
+            ctx.schema = hashed ? schema : NULL;
+            double best = 1e300;
+            for(int r = 0; r < rounds; ++r) {
+                cp_resetCtx(&ctx, 1, argv);
+                double start = now_ns();
+                if(!cp_applyEnv(&ctx, envp)) {
+                    fprintf(stderr, "bench: cp_applyEnv failed\n");
+                    exit(1);
+                }
+                double elapsed = now_ns() - start;
+                if(elapsed < best) best = elapsed;
+            }
+            Result result;
+            snprintf(result.name, sizeof(result.name), "%s", name);
+            // reported per environment variable
+            result.ns_per_token = best / varc;
+            result.instructions_per_token = -1;
+            result.allocations = 0;
+            record(result);
+        }
+        cp_freeSchema(schema);
+        for(int i = 0; i < optc; ++i) {
+            free(envs[i]);
+        }
+        free(envs);
+        free_opts(table);
+    }
+    for(int i = 0; i < varc; ++i) {
+        free(envp[i]);
+    }
+    free(envp);
+}
+
+// `-I value` tens of thousands of times, like build wrappers do
+static void bench_lists(void) {
+    printf("lists:\n");
+    const int tokenss[] = {1000, 100000};
+    char name[96];
+    for(size_t i = 0; i < sizeof(tokenss)/sizeof(*tokenss); ++i) {
+        for(int form = FORM_EQUALS; form <= FORM_SPACE; ++form) {
+            Opt_Table table = make_opts(2, OPTK_STRING_LIST);
+            Cp_Schema *schema = cp_compileOpts(table.optc, table.optv);
+            Parse_Job job = {table, schema, NULL, 0, NULL, make_short_argv(table, tokenss[i], 1, form)};
+            snprintf(name, sizeof(name), "lists/short/%s/tokens=%d", form_names[form], tokenss[i]);
+            measure(name, &job);
+            argv_free(job.argv);
+            job.argv = make_long_argv(table, tokenss[i], form, false);
+            snprintf(name, sizeof(name), "lists/long/%s/tokens=%d", form_names[form], tokenss[i]);
+            measure(name, &job);
+            argv_free(job.argv);
+            cp_freeSchema(schema);
+            free_opts(table);
+        }
+    }
+}
+
+static void bench_enums(void) {
+    printf("enums:\n");
+    const int choicecs[] = {4, 64};
+    const int tokens = quick ? 1000 : 100000;
+    char name[96];
+    char buf[64];
+    for(size_t c = 0; c < sizeof(choicecs)/sizeof(*choicecs); ++c) {
+        int choicec = choicecs[c];
+        Cp_Choice *choices = calloc(choicec + 1, sizeof(Cp_Choice));
+        for(int i = 0; i < choicec; ++i) {
+            char *choice = malloc(32);
+            snprintf(choice, 32, "choice-%d", i);
+            choices[i].name = choice;
+            choices[i].value = i;
+        }
+        Opt_Table table = make_opts(8, OPTK_ENUM);
+        for(int i = 0; i < table.optc; ++i) {
+            table.optv[i].choices = choices;
+        }
+        Argv a = argv_new(tokens);
+        while(a.argc < tokens) {
+            snprintf(buf, sizeof(buf), "--%s=%s", table.names[rng() % table.optc], choices[rng() % choicec].name);
+            argv_push(&a, buf);
+        }
+        Cp_Schema *schema = cp_compileOpts(table.optc, table.optv);
+        for(int hashed = 0; hashed < 2; ++hashed) {
+            Parse_Job job = {table, hashed ? schema : NULL, NULL, 0, NULL, a};
+            snprintf(name, sizeof(name), "enums/%s/choices=%d/tokens=%d", hashed ? "schema" : "linear", choicec, tokens);
+            measure(name, &job);
+        }
+        cp_freeSchema(schema);
+        argv_free(a);
+        free_opts(table);
+        for(int i = 0; i < choicec; ++i) {
+            free((char*)choices[i].name);
+        }
+        free(choices);
+    }
+}
+
+// Every option given is checked against its rules at the end of the parse.
+static void bench_rules(void) {
+    printf("rules:\n");
+    const int optcs[] = {64, 1024};
+    const int tokens = 200;
+    char name[96];
+    char buf[64];
+    for(size_t o = 0; o < sizeof(optcs)/sizeof(*optcs); ++o) {
+        int optc = optcs[o];
+        Opt_Table table = make_opts(optc, OPTK_BOOL);
+        Cp_Schema *schema = cp_compileOpts(table.optc, table.optv);
+        // the first 8 options are required, then pairs of exclusive ones and triples where one requires the others
+        int *indices = malloc(optc * sizeof(int));
+        Cp_Rule *rulev = calloc(optc, sizeof(Cp_Rule));
+        int rulec = 0;
+        for(int i = 0; i < optc; ++i) indices[i] = i;
+        rulev[rulec++] = (Cp_Rule){CP_RULE_REQUIRED, 8, indices};
+        int i = 8;
+        for(; i + 2 <= optc / 2; i += 2) rulev[rulec++] = (Cp_Rule){CP_RULE_EXCLUSIVE, 2, indices + i};
+        for(; i + 3 <= optc; i += 3) rulev[rulec++] = (Cp_Rule){CP_RULE_REQUIRES, 3, indices + i};
+        Cp_Rules *rules = cp_compileRules(table.optc, rulec, rulev);
+
+        // the required options, then one of every exclusive pair
+        Argv a = argv_new(tokens);
+        for(int j = 0; a.argc < tokens; ++j) {
+            int opt = j < 8 ? j : 8 + 2 * (int)(rng() % ((optc / 2 - 8) / 2));
+            snprintf(buf, sizeof(buf), "--%s", table.names[opt]);
+            argv_push(&a, buf);
+        }
+        for(int checked = 0; checked < 2; ++checked) {
+            Parse_Job job = {table, schema, NULL, 0, NULL, a};
+            // bigger tables only track what was seen with the bits `cp_newCtx` allocates
+            job.stack_ctx = optc <= CP_SEEN_INLINE;
+            job.rules = checked ? rules : NULL;
+            snprintf(name, sizeof(name), "rules/%s/opts=%d/rules=%d/tokens=%d", checked ? "checked" : "none", optc, rulec, tokens);
+            measure(name, &job);
+        }
+        argv_free(a);
+        cp_freeRules(rules);
+        free(rulev);
+        free(indices);
+        cp_freeSchema(schema);
+        free_opts(table);
+    }
+}
+
+static void bench_batch(void) {
+    printf("batch:\n");
+    const int threadcs[] = {1, 2, 4, 8};
+    const size_t linec = quick ? 100000 : 1000000;
+    char name[96];
+
+    Opt_Table table = make_opts(100, OPTK_STRING);
+    Cp_Schema *schema = cp_compileOpts(table.optc, table.optv);
+    size_t cap = linec * 96;
+    char *original = malloc(cap+1);
+    char *buf = malloc(cap+1);
+    size_t len = 0;
+    for(size_t i = 0; i < linec; ++i) {
+        len += snprintf(original + len, cap - len, "tool --%s=a/b.txt --%s value input-%zu.c\n",
+            table.names[rng() % table.optc], table.names[rng() % table.optc], i);
+    }
+    original[len] = '\0';
+    Cp_Value *valuev = malloc(linec * table.optc * sizeof(Cp_Value));
+    Cp_Error *errv = malloc(linec * sizeof(Cp_Error));
+
+    for(size_t i = 0; i < sizeof(threadcs)/sizeof(*threadcs); ++i) {
+        snprintf(name, sizeof(name), "batch/threads=%d/lines=%zu", threadcs[i], linec);
+        if(!wanted(name)) continue;
+        double best = 1e300;
+        for(int round = 0; round < 3; ++round) {
+            // parsing writes into the buffer, so every round starts from a fresh copy
+            memcpy(buf, original, len+1);
+            double start = now_ns();
+            long lines = cp_parseBatch(schema, buf, len, '\n', threadcs[i], linec, valuev, errv);
+            double elapsed = now_ns() - start;
+            if(lines != (long)linec) {
+                fprintf(stderr, "bench: batch parsed %ld lines out of %zu\n", lines, linec);
+                exit(1);
+            }
+            if(elapsed < best) best = elapsed;
+        }
+        Result result;
+        snprintf(result.name, sizeof(result.name), "%s", name);
+        // reported per line rather than per token, every line holds 5 tokens
+        result.ns_per_token = best / linec;
+        result.instructions_per_token = -1;
+        result.allocations = 0;
+        record(result);
+    }
+    free(errv);
+    free(valuev);
+    free(buf);
+    free(original);
+    cp_freeSchema(schema);
+    free_opts(table);
+}
+
+static void bench_tokenize(void) {
+    printf("tokenize (%s):\n", CP__SIMD);
+    const size_t len_target = quick ? (4u << 20) : (64u << 20);
+    // plain words only, then one argument in eight quoted or escaped
+    const char *kinds[] = {"plain", "quoted"};
+    char name[96];
+
+    char *original = malloc(len_target + 64);
+    char *buf = malloc(len_target + 64);
+    int argcap = (int)(len_target / 2);
+    char **argv = malloc(argcap * sizeof(char*));
+    for(int k = 0; k < 2; ++k) {
+        size_t len = 0;
+        int expected = 0;
+        while(len < len_target) {
+            uint32_t r = rng();
+            int word = 16 + r % 40;
+            if(k == 1 && r % 8 == 0) {
+                len += snprintf(original + len, 64, "\"--path=some dir/%.*s\" ", word - 12, "abcdefghijklmnopqrstuvwxyzabcdefghijklmnopqrstuvwxyz");
+            } else if(k == 1 && r % 8 == 1) {
+                len += snprintf(original + len, 64, "--name='%.*s\\ x' ", word - 12, "abcdefghijklmnopqrstuvwxyzabcdefghijklmnopqrstuvwxyz");
+            } else {
+                len += snprintf(original + len, 64, "--%.*s ", word - 4, "abcdefghijklmnopqrstuvwxyzabcdefghijklmnopqrstuvwxyz");
+            }
+            ++expected;
+        }
+        original[len] = '\0';
+
+        snprintf(name, sizeof(name), "tokenize/%s/bytes=%zu", kinds[k], len);
+        if(!wanted(name)) continue;
+        double best = 1e300;
+        for(int round = 0; round < 5; ++round) {
+            // tokenizing rewrites the buffer, so every round starts from a fresh copy
+            memcpy(buf, original, len+1);
+            double start = now_ns();
+            int argc = cp_tokenize(buf, len, argcap, argv);
+            double elapsed = now_ns() - start;
+            if(argc != expected) {
+                fprintf(stderr, "bench: tokenized %d arguments out of %d\n", argc, expected);
+                exit(1);
+            }
+            if(elapsed < best) best = elapsed;
+        }
+        printf("  %-44s %8.2f GB/s\n", name, len / best);
+        Result result;
+        snprintf(result.name, sizeof(result.name), "%s", name);
+        result.ns_per_token = best / expected;
+        result.instructions_per_token = -1;
+        result.allocations = 0;
+        record(result);
+    }
+    free(argv);
+    free(buf);
+    free(original);
+}
+
+static void bench_config(void) {
+    printf("config:\n");
+    const size_t len_target = quick ? (8u << 20) : (64u << 20);
+    const int optc = 100;
+    const int per_section = 10;
+    // keys at the top level, then the same options grouped under "[group-N]" headers
+    const char *kinds[] = {"flat", "sections"};
+    char name[96];
+
+    char *original = malloc(len_target + 128);
+    char *buf = malloc(len_target + 128);
+    for(int k = 0; k < 2; ++k) {
+        Opt_Table table = make_opts(optc, OPTK_INT64);
+        if(k == 1) {
+            for(int i = 0; i < optc; ++i) {
+                snprintf(table.names[i], 32, "group-%d.option-%d", i / per_section, i % per_section);
+            }
+        }
+        size_t len = 0;
+        size_t lines = 0;
+        while(len < len_target) {
+            uint32_t r = rng();
+            int i = r % optc;
+            if(r % 16 == 0) {
+                len += snprintf(original + len, 128, "# a comment about option %d\n", i);
+            } else if(k == 1) {
+                len += snprintf(original + len, 128, "[group-%d]\noption-%d = %u\n", i / per_section, i % per_section, r >> 8);
+            } else {
+                len += snprintf(original + len, 128, "option-number-%d = %u\n", i, r >> 8);
+            }
+            ++lines;
+        }
+        original[len] = '\0';
+
+        Cp_Schema *schema = cp_compileOpts(table.optc, table.optv);
+        char *argv[] = {"bench", NULL};
+        for(int hashed = 0; hashed < 2; ++hashed) {
+            snprintf(name, sizeof(name), "config/%s/%s/bytes=%zu", kinds[k], hashed ? "schema" : "linear", len);
+            if(!wanted(name)) continue;
+            Cp_Ctx ctx;
+            cp_initCtx(&ctx, 1, argv, table.optc, table.optv, 0, NULL);
+            ctx.schema = hashed ? schema : NULL;
+            double best = 1e300;
+            for(int round = 0; round < 3; ++round) {
+                // parsing terminates keys and values in place, so every round starts from a fresh copy
+                memcpy(buf, original, len+1);
+                cp_resetCtx(&ctx, 1, argv);
+                double start = now_ns();
+                if(!cp_parseConfig(&ctx, buf, len)) {
+                    fprintf(stderr, "bench: cp_parseConfig failed\n");
+                    exit(1);
+                }
+                double elapsed = now_ns() - start;
+                if(elapsed < best) best = elapsed;
+            }
+            printf("  %-44s %8.2f GB/s\n", name, len / best);
+            Result result;
+            snprintf(result.name, sizeof(result.name), "%s", name);
+            // reported per line
+            result.ns_per_token = best / lines;
+            result.instructions_per_token = -1;
+            result.allocations = 0;
+            record(result);
+        }
+        cp_freeSchema(schema);
+        free_opts(table);
+    }
+    free(buf);
+    free(original);
+}
+
+// The help as `cp_usage` printed it before it rendered into a buffer, one `fprintf` per piece.
+static void usage_printf(Cp_Ctx *ctx, FILE *file) {
+    int maxlen = 0;
+    for(uintmax_t i = 0; i < ctx->optc; ++i) {
+        int len = strlen(ctx->optv[i].name);
+        if(ctx->optv[i].short_name != '\0') {
+            len += 2;
+        }
+        if(len > maxlen) maxlen = len;
+    }
+    fprintf(file, "OPTIONS:\n");
+    for(uintmax_t i = 0; i < ctx->optc; ++i) {
+        Cp_Opt opt = ctx->optv[i];
+        fprintf(file, "  %s", opt.name);
+        if(opt.short_name != '\0') {
+            fprintf(file, ", %c", opt.short_name);
+        }
+        int printed_len = opt.short_name != '\0' ? (int)strlen(opt.name) + 3 : (int)strlen(opt.name);
+        fprintf(file, "%-*s", maxlen - printed_len + 2, "");
+        fprintf(file, " : %s\n", opt.short_desc);
+    }
+}
+
+static void bench_help(void) {
+    printf("help:\n");
+    FILE *null = fopen("/dev/null", "w");
+    if(null == NULL) return;
+    const char *ways[] = {"printf", "render", "cached"};
+    const int optcs[] = {20, 200};
+    char name[96];
+    for(size_t o = 0; o < sizeof(optcs)/sizeof(*optcs); ++o) {
+        Opt_Table table = make_opts(optcs[o], OPTK_STRING);
+        for(int i = 0; i < table.optc; ++i) {
+            table.optv[i].long_desc = i % 4 == 0
+                ? "A longer description of the option, long enough to be wrapped over a few lines at 80 columns, "
+                  "saying what it is used for and what its default value is."
+                : NULL;
+        }
+        Cp_Schema *schema = cp_compileOpts(table.optc, table.optv);
+        char *argv[] = {"bench", NULL};
+        Cp_Ctx ctx;
+        cp_initCtx(&ctx, 1, argv, table.optc, table.optv, 0, NULL);
+        ctx.schema = schema;
+        for(int w = 0; w < 3; ++w) {
+            snprintf(name, sizeof(name), "help/%s/opts=%d", ways[w], table.optc);
+            if(!wanted(name)) continue;
+            Cp_Help help = {0};
+            double budget_ns = quick ? 2e7 : 2e8;
+            double best = 1e300;
+            double spent = 0;
+            long rounds = 0;
+            long allocs = 0;
+            while(rounds < 3 || (spent < budget_ns && rounds < 100000)) {
+                long allocs_before = alloc_count;
+                double start = now_ns();
+                if(w == 0) {
+                    usage_printf(&ctx, null);
+                } else if(w == 1) {
+                    cp_usage(&ctx, null);
+                } else {
+                    size_t len;
+                    const char *text = cp_helpText(&help, &ctx, 80, &len);
+                    fwrite(text, 1, len, null);
+                }
+                double elapsed = now_ns() - start;
+                allocs = alloc_count - allocs_before;
+                if(elapsed < best) best = elapsed;
+                spent += elapsed;
+                ++rounds;
+            }
+            cp_freeHelp(&help);
+            Result result;
+            snprintf(result.name, sizeof(result.name), "%s", name);
+            // reported per option line
+            result.ns_per_token = best / table.optc;
+            result.instructions_per_token = -1;
+            result.allocations = (double)allocs;
+            record(result);
+        }
+        cp_freeSchema(schema);
+        free_opts(table);
+    }
+    fclose(null);
+}
+
+// A shell asking for candidates, from the argv the program gets to the lines written out.
+// `scan` is what a program started for every Tab press does, `index` reuses an index built beforehand
+// and `index+build` builds it for the one query.
+static void bench_complete(void) {
+    printf("completion:\n");
+    FILE *null = fopen("/dev/null", "w");
+    if(null == NULL) return;
+    const int optc = 10000;
+    const int subcommandc = 100;
+    Opt_Table table = make_opts(optc, OPTK_STRING);
+    char **subcommandv = calloc(subcommandc, sizeof(char*));
+    for(int i = 0; i < subcommandc; ++i) {
+        subcommandv[i] = malloc(16);
+        snprintf(subcommandv[i], 16, "sub-%d", i);
+    }
+    Cp_CompletionIndex *index = cp_compileCompletion(optc, table.optv, subcommandc, (const char**)subcommandv);
+    const char *queries[] = {"--option-number-9999", "--option-number-12", "--", "sub-4"};
+    const char *ways[] = {"scan", "index", "index+build"};
+    char name[96];
+    for(size_t q = 0; q < sizeof(queries)/sizeof(*queries); ++q) {
+        char *argv[] = {"bench", CP_COMPLETE_COMMAND, "--quick", (char*)queries[q], NULL};
+        for(int w = 0; w < 3; ++w) {
+            snprintf(name, sizeof(name), "complete/%s/opts=%d/word=%s", ways[w], optc, queries[q]);
+            if(!wanted(name)) continue;
+            double budget_ns = quick ? 2e7 : 2e8;
+            double best = 1e300;
+            double spent = 0;
+            long rounds = 0;
+            long allocs = 0;
+            int count = 0;
+            while(rounds < 3 || (spent < budget_ns && rounds < 10000)) {
+                long allocs_before = alloc_count;
+                double start = now_ns();
+                Cp_Ctx ctx;
+                cp_initCtx(&ctx, 4, argv, table.optc, table.optv, 0, NULL);
+                if(w == 0) {
+                    count = cp_complete(&ctx, NULL, subcommandc, (const char**)subcommandv, null);
+                } else if(w == 1) {
+                    count = cp_complete(&ctx, index, subcommandc, (const char**)subcommandv, null);
+                } else {
+                    Cp_CompletionIndex *built = cp_compileCompletion(optc, table.optv, subcommandc, (const char**)subcommandv);
+                    count = cp_complete(&ctx, built, subcommandc, (const char**)subcommandv, null);
+                    cp_freeCompletion(built);
+                }
+                fflush(null);
+                double elapsed = now_ns() - start;
+                allocs = alloc_count - allocs_before;
+                if(elapsed < best) best = elapsed;
+                spent += elapsed;
+                ++rounds;
+            }
+            printf("  %-52s %10.1f us/query %6d candidates\n", name, best / 1e3, count);
+            Result result;
+            snprintf(result.name, sizeof(result.name), "%s", name);
+            // reported per query
+            result.ns_per_token = best;
+            result.instructions_per_token = -1;
+            result.allocations = (double)allocs;
+            record(result);
+        }
+    }
+    cp_freeCompletion(index);
+    for(int i = 0; i < subcommandc; ++i) {
+        free(subcommandv[i]);
+    }
+    free(subcommandv);
+    free_opts(table);
+    fclose(null);
+}
+
+// A command tree `depth` levels deep, every command with 16 options and 8 subcommands of which the
+// 4th leads further down, walked by a command line giving 4 options at each level.
+// `tree` parses it with `cp_parseCommand` and one context, `recreate` the way `example_subcommand.c` used to:
+// a new context and `argumentv` per level, subcommands found by comparing `argv[stopped]` again.
+#define TREE_OPTC 16
+#define TREE_SUBC 8
+typedef struct {
+    Cp_Command commands[6][TREE_SUBC];
+    Cp_Opt optv[6][TREE_OPTC];
+    char names[6][TREE_OPTC][32];
+    char subnames[6][TREE_SUBC][16];
+    const char *subv[6][TREE_SUBC];
+    Cp_Value holders[6][TREE_OPTC];
+    Cp_Command root;
+} Command_Tree;
+
+static void make_tree(Command_Tree *tree, int depth) {
+    memset(tree, 0, sizeof(*tree));
+    for(int level = 0; level < depth; ++level) {
+        for(int i = 0; i < TREE_OPTC; ++i) {
+            snprintf(tree->names[level][i], 32, "level-%d-option-%d", level, i);
+            Cp_Opt opt = {&tree->holders[level][i], i % 2 ? OPTK_INT64 : OPTK_BOOL, tree->names[level][i], 0, "Synthetic option."};
+            memcpy(&tree->optv[level][i], &opt, sizeof(opt));
+        }
+    }
+    // level `l` commands hold the options of level `l+1`, the root those of level 0
+    for(int level = 0; level < depth; ++level) {
+        for(int i = 0; i < TREE_SUBC; ++i) {
+            snprintf(tree->subnames[level][i], 16, "cmd-%d-%d", level, i);
+            tree->subv[level][i] = tree->subnames[level][i];
+            Cp_Command *command = &tree->commands[level][i];
+            command->name = tree->subnames[level][i];
+            if(level + 1 < depth) {
+                command->optc = TREE_OPTC;
+                command->optv = tree->optv[level + 1];
+            } else {
+                command->optc = 1;
+                command->optv = tree->optv[0];
+            }
+            if(i == 3 && level + 1 < depth - 1) {
+                command->subc = TREE_SUBC;
+                command->subv = tree->commands[level + 1];
+            }
+        }
+    }
+    tree->root.optc = TREE_OPTC;
+    tree->root.optv = tree->optv[0];
+    tree->root.subc = TREE_SUBC;
+    tree->root.subv = tree->commands[0];
+}
+
+static void bench_commands(void) {
+    printf("command trees:\n");
+    const int depths[] = {4, 6};
+    const int lines = quick ? 2000 : 20000;
+    char name[96];
+    Command_Tree *tree = malloc(sizeof(Command_Tree));
+    for(size_t d = 0; d < sizeof(depths)/sizeof(*depths); ++d) {
+        int depth = depths[d];
+        make_tree(tree, depth);
+        Argv a = argv_new(depth * 6 + 8);
+        char buf[64];
+        for(int level = 0; level < depth; ++level) {
+            int optc = level == 0 ? TREE_OPTC : tree->commands[level - 1][3].optc;
+            Cp_Opt *optv = level == 0 ? tree->root.optv : tree->commands[level - 1][3].optv;
+            for(int j = 0; j < 4 && j < optc; ++j) {
+                int i = (int)(rng() % optc);
+                snprintf(buf, sizeof(buf), optv[i].kind == OPTK_BOOL ? "--%s" : "--%s=42", optv[i].name);
+                argv_push(&a, buf);
+            }
+            if(level + 1 < depth) argv_push(&a, tree->subnames[level][3]);
+        }
+        for(int j = 0; j < 4; ++j) {
+            snprintf(buf, sizeof(buf), "file-%d.c", j);
+            argv_push(&a, buf);
+        }
+
+        for(int recreate = 0; recreate < 2; ++recreate) {
+            snprintf(name, sizeof(name), "command-tree/%s/depth=%d/tokens=%d", recreate ? "recreate" : "tree", depth, a.argc);
+            if(!wanted(name)) continue;
+            char **argumentv = malloc(a.argc * sizeof(char*));
+            double best = 1e300;
+            long allocs = 0;
+            for(int round = 0; round < 5; ++round) {
+                long allocs_before = alloc_count;
+                double start = now_ns();
+                for(int line = 0; line < lines; ++line) {
+                    if(!recreate) {
+                        Cp_Ctx ctx;
+                        cp_initCtx(&ctx, a.argc, a.argv, tree->root.optc, tree->root.optv, a.argc, argumentv);
+                        if(cp_parseCommand(&ctx, &tree->root) == NULL) {
+                            fprintf(stderr, "bench: cp_parseCommand failed\n");
+                            exit(1);
+                        }
+                        continue;
+                    }
+                    const Cp_Command *command = &tree->root;
+                    int offset = 0;
+                    while(true) {
+                        char **level_argumentv = counting_calloc(a.argc - offset, sizeof(char*));
+                        Cp_Ctx *ctx = cp_newCtx(a.argc - offset, a.argv + offset, command->optc, command->optv, a.argc - offset, level_argumentv);
+                        const char *subv[TREE_SUBC];
+                        for(uintmax_t i = 0; i < command->subc; ++i) subv[i] = command->subv[i].name;
+                        int stopped = cp_parseUntil(ctx, command->subc, subv);
+                        if(stopped < 0) {
+                            fprintf(stderr, "bench: cp_parseUntil failed\n");
+                            exit(1);
+                        }
+                        cp_freeCtx(ctx);
+                        free(level_argumentv);
+                        if(offset + stopped >= a.argc) break;
+                        const Cp_Command *next = NULL;
+                        for(uintmax_t i = 0; i < command->subc; ++i) {
+                            if(cp__streq(subv[i], a.argv[offset + stopped])) next = &command->subv[i];
+                        }
+                        command = next;
+                        offset += stopped;
+                    }
+                }
+                double elapsed = (now_ns() - start) / lines;
+                allocs = (alloc_count - allocs_before) / lines;
+                if(elapsed < best) best = elapsed;
+            }
+            free(argumentv);
+            Result result;
+            snprintf(result.name, sizeof(result.name), "%s", name);
+            result.ns_per_token = best / a.argc;
+            result.instructions_per_token = -1;
+            result.allocations = (double)allocs;
+            record(result);
+        }
+        argv_free(a);
+    }
+    free(tree);
+}
+
+// One record per command line, e.g. a job queue where every line describes a job.
+typedef struct {
+    bool verbose;
+    int64_t id;
+    uint64_t retries;
+    double ratio;
+    char *name;
+    char *queue;
+} Job_Record;
+
+static void job_opts(Cp_Opt optv[6], Job_Record *job) {
+    Cp_Opt opts[6] = {
+        {&job->verbose, OPTK_BOOL, "verbose", 'v'},
+        {&job->id, OPTK_INT64, "id", 'i'},
+        {&job->retries, OPTK_UINT64, "retries", 'r'},
+        {&job->ratio, OPTK_DOUBLE, "ratio", 0},
+        {&job->name, OPTK_STRING, "name", 'n'},
+        {&job->queue, OPTK_STRING, "queue", 'q'}
+    };
+    memcpy(optv, opts, sizeof(opts));
+}
+
+static void bench_records(void) {
+    printf("records:\n");
+    const int recordc = quick ? 2000 : 20000;
+    char name[96];
+    Argv a = argv_new(9);
+    argv_push(&a, "--verbose");
+    argv_push(&a, "--id=1234");
+    argv_push(&a, "-r");
+    argv_push(&a, "3");
+    argv_push(&a, "--ratio=0.75");
+    argv_push(&a, "--name=render");
+    argv_push(&a, "-q");
+    argv_push(&a, "gpu");
+    Job_Record *jobs = calloc(recordc, sizeof(Job_Record));
+
+    Cp_Opt fields[6] = {
+        {CP_FIELD(Job_Record, verbose), OPTK_BOOL, "verbose", 'v'},
+        {CP_FIELD(Job_Record, id), OPTK_INT64, "id", 'i'},
+        {CP_FIELD(Job_Record, retries), OPTK_UINT64, "retries", 'r'},
+        {CP_FIELD(Job_Record, ratio), OPTK_DOUBLE, "ratio", 0},
+        {CP_FIELD(Job_Record, name), OPTK_STRING, "name", 'n'},
+        {CP_FIELD(Job_Record, queue), OPTK_STRING, "queue", 'q'}
+    };
+    Cp_Schema *schema = cp_compileOpts(6, fields);
+
+    // "rebuild" makes a table pointing at every record, as was needed before offsets, "into" shares one schema
+    const char *modes[] = {"rebuild", "rebuild-schema", "into"};
+    for(int mode = 0; mode < 3; ++mode) {
+        snprintf(name, sizeof(name), "records/%s/records=%d", modes[mode], recordc);
+        if(!wanted(name)) continue;
+        double best = 1e300;
+        long allocs = 0;
+        for(int round = 0; round < 5; ++round) {
+            long allocs_before = alloc_count;
+            double start = now_ns();
+            for(int i = 0; i < recordc; ++i) {
+                int stopped;
+                if(mode == 2) {
+                    stopped = cp_parseInto(schema, a.argc, a.argv, &jobs[i], NULL);
+                } else {
+                    Cp_Opt optv[6];
+                    job_opts(optv, &jobs[i]);
+                    Cp_Schema *job_schema = mode == 1 ? cp_compileOpts(6, optv) : NULL;
+                    Cp_Ctx ctx;
+                    cp_initCtx(&ctx, a.argc, a.argv, 6, optv, 0, NULL);
+                    ctx.schema = job_schema;
+                    stopped = cp_parse(&ctx) < 0 ? -1 : ctx.argumentc;
+                    cp_freeSchema(job_schema);
+                }
+                // the program name is the only positional argument
+                if(stopped != 1) {
+                    fprintf(stderr, "bench: records/%s failed\n", modes[mode]);
+                    exit(1);
+                }
+            }
+            double elapsed = (now_ns() - start) / recordc;
+            allocs = (alloc_count - allocs_before) / recordc;
+            if(elapsed < best) best = elapsed;
+        }
+        if(jobs[recordc - 1].id != 1234 || strcmp(jobs[recordc - 1].queue, "gpu") != 0) {
+            fprintf(stderr, "bench: records/%s filled the wrong fields\n", modes[mode]);
+            exit(1);
+        }
+        memset(jobs, 0, recordc * sizeof(Job_Record));
+        Result result;
+        snprintf(result.name, sizeof(result.name), "%s", name);
+        result.ns_per_token = best / a.argc;
+        result.instructions_per_token = -1;
+        result.allocations = (double)allocs;
+        record(result);
+    }
+    cp_freeSchema(schema);
+    free(jobs);
+    argv_free(a);
+}
+
+// Parsers for the tables of `bench_generated`, written by `--generate` then built into a second bench.elf.
+static const Cp_Opt_Kind generated_kinds[] = {OPTK_BOOL, OPTK_INT64, OPTK_STRING};
+static const char *generated_prefixes[] = {"bench_gen_bool", "bench_gen_int64", "bench_gen_string"};
+
+static bool write_generated(const char *path) {
+    FILE *file = fopen(path, "w");
+    if(file == NULL) {
+        fprintf(stderr, "bench: could not write %s\n", path);
+        return false;
+    }
+    bool ok = true;
+    for(size_t k = 0; k < sizeof(generated_kinds)/sizeof(*generated_kinds); ++k) {
+        Opt_Table table = make_opts(100, generated_kinds[k]);
+        ok = ok && cp_generateParser(file, generated_prefixes[k], table.optc, table.optv);
+        free_opts(table);
+    }
+    return fclose(file) == 0 && ok;
+}
+
+#ifdef CP_BENCH_GENERATED
+int bench_gen_bool_parseUntil(Cp_Ctx *ctx, uintmax_t subcommandc, const char *subcommandv[]);
+int bench_gen_int64_parseUntil(Cp_Ctx *ctx, uintmax_t subcommandc, const char *subcommandv[]);
+int bench_gen_string_parseUntil(Cp_Ctx *ctx, uintmax_t subcommandc, const char *subcommandv[]);
+#endif
+
+static void bench_generated(void) {
+    printf("generated parsers:\n");
+#ifdef CP_BENCH_GENERATED
+    int (*parsers[])(Cp_Ctx*, uintmax_t, const char*[]) = {
+        bench_gen_bool_parseUntil, bench_gen_int64_parseUntil, bench_gen_string_parseUntil
+    };
+    const int tokens = quick ? 10000 : 100000;
+    char name[96];
+    for(size_t k = 0; k < sizeof(generated_kinds)/sizeof(*generated_kinds); ++k) {
+        Opt_Table table = make_opts(100, generated_kinds[k]);
+        Cp_Schema *schema = cp_compileOpts(table.optc, table.optv);
+        Argv argvs[2];
+        const char *forms[2];
+        if(generated_kinds[k] == OPTK_BOOL) {
+            argvs[0] = make_long_argv(table, tokens, FORM_FLAG, false);
+            argvs[1] = make_short_argv(table, tokens, 4, FORM_FLAG);
+            forms[0] = "long/flag";
+            forms[1] = "short/cluster=4";
+        } else {
+            bool numeric = generated_kinds[k] == OPTK_INT64;
+            argvs[0] = make_long_argv(table, tokens, FORM_EQUALS, numeric);
+            argvs[1] = make_long_argv(table, tokens, FORM_SPACE, numeric);
+            forms[0] = numeric ? "long/equals/int64" : "long/equals/string";
+            forms[1] = numeric ? "long/space/int64" : "long/space/string";
+        }
+        for(int a = 0; a < 2; ++a) {
+            Parse_Job job = {table, schema, NULL, 0, NULL, argvs[a]};
+            job.stack_ctx = true;
+            snprintf(name, sizeof(name), "generated/%s/schema/opts=100/tokens=%d", forms[a], tokens);
+            measure(name, &job);
+            job.schema = NULL;
+            job.generated = parsers[k];
+            snprintf(name, sizeof(name), "generated/%s/generated/opts=100/tokens=%d", forms[a], tokens);
+            measure(name, &job);
+            argv_free(argvs[a]);
+        }
+        cp_freeSchema(schema);
+        free_opts(table);
+    }
+#else
+    printf("  skipped, `./bench.sh` builds them in\n");
+#endif
+}
+
+// ---- output and comparison ----
+
+static bool write_results(const char *path) {
+    FILE *file = fopen(path, "w");
+    if(file == NULL) {
+        fprintf(stderr, "bench: could not open '%s' for writing.\n", path);
+        return false;
+    }
+    fprintf(file, "# name\tns_per_token\tinstructions_per_token\tallocations\n");
+    for(int i = 0; i < resultc; ++i) {
+        fprintf(file, "%s\t%.3f\t%.3f\t%.0f\n",
+            results[i].name, results[i].ns_per_token, results[i].instructions_per_token, results[i].allocations);
+    }
+    fclose(file);
+    return true;
+}
+
+static int read_results(const char *path, Result **out) {
+    FILE *file = fopen(path, "r");
+    if(file == NULL) {
+        fprintf(stderr, "bench: could not open '%s'.\n", path);
+        return -1;
+    }
+    int count = 0, cap = 64;
+    Result *read = malloc(cap * sizeof(Result));
+    char line[256];
+    while(fgets(line, sizeof(line), file) != NULL) {
+        if(line[0] == '#') continue;
+        if(count == cap) {
+            cap *= 2;
+            read = realloc(read, cap * sizeof(Result));
+        }
+        Result *r = &read[count];
+        if(sscanf(line, "%95[^\t]\t%lf\t%lf\t%lf", r->name, &r->ns_per_token, &r->instructions_per_token, &r->allocations) == 4) {
+            ++count;
+        }
+    }
+    fclose(file);
+    *out = read;
+    return count;
+}
+
+// Flags cases that got slower than `threshold` percent, or that allocate more. Returns 1 if any did.
+static int compare(const char *old_path, const char *new_path, double threshold) {
+    Result *olds, *news;
+    int oldc = read_results(old_path, &olds);
+    int newc = read_results(new_path, &news);
+    if(oldc < 0 || newc < 0) {
+        return 2;
+    }
+    int regressions = 0;
+    printf("%-52s %12s %12s %9s\n", "case", "old ns", "new ns", "change");
+    for(int i = 0; i < newc; ++i) {
+        for(int j = 0; j < oldc; ++j) {
+            if(strcmp(news[i].name, olds[j].name) != 0) continue;
+            // instructions are a lot less noisy than time, prefer them when both runs have them
+            bool by_instructions = news[i].instructions_per_token > 0 && olds[j].instructions_per_token > 0;
+            double before = by_instructions ? olds[j].instructions_per_token : olds[j].ns_per_token;
+            double after = by_instructions ? news[i].instructions_per_token : news[i].ns_per_token;
+            double change = before > 0 ? (after - before) / before * 100.0 : 0;
+            bool regressed = change > threshold || news[i].allocations > olds[j].allocations;
+            printf("%-52s %12.1f %12.1f %+8.1f%%%s\n",
+                news[i].name, olds[j].ns_per_token, news[i].ns_per_token, change, regressed ? "  REGRESSION" : "");
+            regressions += regressed;
+        }
+    }
+    printf("%d regression(s) over %.1f%%.\n", regressions, threshold);
+    free(olds);
+    free(news);
+    return regressions > 0;
+}
+
+int main(int argc, char *argv[]) {
+    bool help = false;
+    bool compare_mode = false;
+    char *output = "bench_output.txt";
+    char *generate = NULL;
+    double threshold = 10;
+    Cp_Opt opts[] = {
+        {&help, OPTK_BOOL, "help", 'h', "Prints this help message."},
+        {&quick, OPTK_BOOL, "quick", 'q', "Smaller workloads and shorter runs."},
+        {&filter, OPTK_STRING, "filter", 'f', "Only runs cases whose name contains this."},
+        {&output, OPTK_STRING, "output", 'o', "Where to write the results, `bench_output.txt` by default."},
+        {&compare_mode, OPTK_BOOL, "compare", 'c', "Compares two result files given as arguments instead of running."},
+        {&threshold, OPTK_DOUBLE, "threshold", 't', "Percentage over which a slowdown counts as a regression, 10 by default."},
+        {&generate, OPTK_STRING, "generate", 'g', "Writes the parsers of the `generated` cases to this file instead of running."}
+    };
+    char **argumentv = malloc(argc * sizeof(char*));
+    Cp_Ctx *ctx = cp_newCtx(argc, argv, sizeof(opts)/sizeof(*opts), opts, argc, argumentv);
+    if(ctx == NULL) {
+        return 1;
+    }
+    if(cp_parse(ctx) == -1) {
+        char err[256];
+        cp_formatError(ctx, err, sizeof(err));
+        printf("ERROR: %s\n", err);
+        return 1;
+    }
+    if(help) {
+        cp_usage(ctx, stdout);
+        return 0;
+    }
+    if(compare_mode) {
+        // argument 0 is the program name
+        if(ctx->argumentc != 3) {
+            printf("ERROR: `--compare` takes exactly two result files.\n");
+            return 1;
+        }
+        return compare(ctx->argumentv[1], ctx->argumentv[2], threshold);
+    }
+    cp_freeCtx(ctx);
+    free(argumentv);
+    if(generate != NULL) {
+        return write_generated(generate) ? 0 : 1;
+    }
+
+    counter_init();
+    if(perf_fd < 0) {
+        printf("note: hardware instruction counters are unavailable, instructions are reported as n/a.\n");
+    }
+    bench_long();
+    bench_short();
+    bench_positionals();
+    bench_subcommands();
+    bench_commands();
+    bench_records();
+    bench_numbers();
+    bench_lists();
+    bench_enums();
+    bench_rules();
+    bench_env();
+    bench_batch();
+    bench_tokenize();
+    bench_config();
+    bench_help();
+    bench_complete();
+    bench_generated();
+
+    if(!write_results(output)) {
+        return 1;
+    }
+    printf("Results written to %s.\n", output);
+    return 0;
+}
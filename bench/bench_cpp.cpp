@@ -0,0 +1,210 @@
+// Compares `cp::Parser` from cli-parser.hpp against `cp_parse` with a schema on the same command lines.
+// The C side is linked from its own translation unit, see `./bench.sh cpp`.
+// Reports ns per token for both and how much faster the C++ parser is.
+
+#include "cli-parser.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <string>
+#include <utility>
+#include <vector>
+
+static double now_ns() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+// xorshift, the same sequence as bench.c
+static uint32_t rng_state = 2463534242u;
+static uint32_t rng() {
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 17;
+    rng_state ^= rng_state << 5;
+    return rng_state;
+}
+
+static constexpr char short_names[] = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789";
+constexpr size_t SHORT_NAMEC = sizeof(short_names) - 1;
+constexpr size_t OPTC = 100;
+
+// ---- option tables, `option-number-N` like bench.c ----
+
+template<size_t I>
+constexpr auto optionName() {
+    constexpr size_t digits = I < 10 ? 1 : I < 100 ? 2 : 3;
+    char str[15 + digits] = "option-number-";
+    for(size_t i = 0, n = I; i < digits; ++i, n /= 10) {
+        str[14 + digits - 1 - i] = (char)('0' + n % 10);
+    }
+    str[14 + digits] = '\0';
+    return cp::Name<15 + digits>(str);
+}
+// the short names go to the last options, same as `make_opts`
+template<size_t I>
+constexpr char shortName() {
+    return OPTC - 1 - I < SHORT_NAMEC ? short_names[OPTC - 1 - I] : '\0';
+}
+
+template<class V, size_t I>
+struct Slot {
+    V value;
+};
+template<class V, class Seq>
+struct Values;
+template<class V, size_t... I>
+struct Values<V, std::index_sequence<I...>> : Slot<V, I>... {
+    using Cli = cp::Parser<Values, cp::Opt<&Slot<V, I>::value, optionName<I>(), shortName<I>(), "Synthetic option.">...>;
+};
+
+template<class V>
+using Table = Values<V, std::make_index_sequence<OPTC>>;
+
+// `Cp_Opt` has a const member, so it is filled with memcpy like in bench.c
+struct C_Table {
+    Cp_Opt *optv;
+    std::vector<Cp_Value> holders;
+    std::vector<std::string> names;
+    Cp_Schema *schema;
+};
+static C_Table makeCTable(Cp_Opt_Kind kind) {
+    C_Table table;
+    table.optv = (Cp_Opt*)calloc(OPTC, sizeof(Cp_Opt));
+    table.holders.resize(OPTC);
+    table.names.resize(OPTC);
+    for(size_t i = 0; i < OPTC; ++i) {
+        table.names[i] = "option-number-" + std::to_string(i);
+        size_t from_end = OPTC - 1 - i;
+        char short_name = from_end < SHORT_NAMEC ? short_names[from_end] : 0;
+        Cp_Opt opt = {&table.holders[i], kind, table.names[i].c_str(), short_name, (char*)"Synthetic option."};
+        memcpy((void*)&table.optv[i], &opt, sizeof(opt));
+    }
+    table.schema = cp_compileOpts(OPTC, table.optv);
+    return table;
+}
+
+// ---- command lines ----
+
+enum Form { FORM_FLAG, FORM_EQUALS, FORM_SPACE, FORM_CLUSTER };
+
+static std::vector<std::string> makeArgs(int tokens, Form form, const char *value) {
+    std::vector<std::string> args = {"bench"};
+    while((int)args.size() < tokens) {
+        std::string name = "option-number-" + std::to_string(rng() % OPTC);
+        switch(form) {
+            case FORM_FLAG: args.push_back("--" + name); break;
+            case FORM_EQUALS: args.push_back("--" + name + "=" + value); break;
+            case FORM_SPACE: {
+                if((int)args.size() + 1 >= tokens) {
+                    args.push_back("positional.c");
+                    continue;
+                }
+                args.push_back("--" + name);
+                args.push_back(value);
+            } break;
+            case FORM_CLUSTER: {
+                std::string cluster = "-";
+                for(int j = 0; j < 4; ++j) {
+                    cluster += short_names[rng() % SHORT_NAMEC];
+                }
+                args.push_back(cluster);
+            } break;
+        }
+    }
+    return args;
+}
+
+// ---- measuring ----
+
+static bool quick = false;
+
+template<class F>
+static double best(F &&parse) {
+    double budget_ns = quick ? 2e7 : 2e8;
+    double best = 1e300;
+    double spent = 0;
+    for(long rounds = 0; rounds < 3 || (spent < budget_ns && rounds < 1000); ++rounds) {
+        double start = now_ns();
+        parse();
+        double elapsed = now_ns() - start;
+        if(elapsed < best) best = elapsed;
+        spent += elapsed;
+    }
+    return best;
+}
+
+template<class V>
+static void compare(const char *name, Cp_Opt_Kind kind, Form form, const char *value) {
+    int tokens = quick ? 10000 : 100000;
+    std::vector<std::string> args = makeArgs(tokens, form, value);
+    std::vector<char*> argv;
+    for(std::string &arg : args) {
+        argv.push_back(arg.data());
+    }
+    int argc = (int)argv.size();
+    std::vector<char*> c_argumentv(argc);
+    std::vector<std::string_view> cpp_argumentv(argc);
+
+    C_Table table = makeCTable(kind);
+    double c_ns = best([&] {
+        Cp_Ctx ctx;
+        cp_initCtx(&ctx, argc, argv.data(), OPTC, table.optv, argc, c_argumentv.data());
+        ctx.schema = table.schema;
+        if(cp_parse(&ctx) != argc) {
+            fprintf(stderr, "bench: C parse failed\n");
+            exit(1);
+        }
+    });
+    cp_freeSchema(table.schema);
+    free(table.optv);
+
+    auto *values = new Table<V>();
+    double cpp_ns = best([&] {
+        typename Table<V>::Cli cli(*values, cpp_argumentv);
+        if(cli.parse(argc, argv.data()) != argc) {
+            char err[256];
+            cli.formatError(err, sizeof(err));
+            fprintf(stderr, "bench: C++ parse failed: %s\n", err);
+            exit(1);
+        }
+    });
+    delete values;
+
+    printf("  %-40s %8.1f ns/token (C) %8.1f ns/token (C++) %6.2fx\n", name, c_ns / argc, cpp_ns / argc, c_ns / cpp_ns);
+}
+
+int main(int argc, char *argv[]) {
+    struct Args {
+        bool help = false;
+        bool quick = false;
+    } args;
+    using Cli = cp::Parser<Args,
+        cp::Opt<&Args::help, "help", 'h', "Prints this help message.">,
+        cp::Opt<&Args::quick, "quick", 'q', "Smaller workloads and shorter runs.">
+    >;
+    Cli cli(args);
+    if(cli.parse(argc - 1, argv + 1) == -1) {
+        char err[256];
+        cli.formatError(err, sizeof(err));
+        printf("ERROR: %s\n", err);
+        return 1;
+    }
+    if(args.help) {
+        for(size_t i = 0; i < Cli::optc; ++i) {
+            printf("  --%s, -%c : %s\n", Cli::names[i].data(), Cli::short_names[i], Cli::short_descs[i].data());
+        }
+        return 0;
+    }
+    quick = args.quick;
+
+    printf("C (schema) against C++ (cli-parser.hpp), %zu options:\n", OPTC);
+    compare<bool>("long/flag", OPTK_BOOL, FORM_FLAG, "");
+    compare<std::string_view>("long/equals/string", OPTK_STRING, FORM_EQUALS, "some/value.txt");
+    compare<int64_t>("long/equals/int64", OPTK_INT64, FORM_EQUALS, "12345");
+    compare<int64_t>("long/space/int64", OPTK_INT64, FORM_SPACE, "12345");
+    compare<double>("long/equals/double", OPTK_DOUBLE, FORM_EQUALS, "3.25");
+    compare<bool>("short/cluster=4", OPTK_BOOL, FORM_CLUSTER, "");
+    return 0;
+}
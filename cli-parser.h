@@ -57,7 +57,10 @@ THE SOFTWARE.
 #ifndef CLI_PARSER_H
 #define CLI_PARSER_H
 
+#include <errno.h>
 #include <limits.h>
+#include <locale.h>
+#include <math.h>
 #include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
@@ -65,11 +68,89 @@ THE SOFTWARE.
 #include <stdlib.h>
 #include <string.h>
 
+// Define "CP_NO_MALLOC" to compile out everything that allocates. Contexts then go through `cp_initCtx`
+// and schemas through `cp_compileOptsInto`, both on storage owned by the caller.
+// Otherwise, define these before including the implementation to route the library's allocations elsewhere.
+#ifndef CP_NO_MALLOC
+#ifndef CP_CALLOC
+#define CP_CALLOC calloc
+#endif
+#ifndef CP_FREE
+#define CP_FREE free
+#endif
+#ifndef CP_REALLOC
+#define CP_REALLOC realloc
+#endif
+#endif
+
+// Limits for "@file" response files, see `Cp_Ctx.response_files`. A file naming itself hits the depth limit.
+#ifndef CP_RESPONSE_FILE_DEPTH
+#define CP_RESPONSE_FILE_DEPTH 16
+#endif
+#ifndef CP_RESPONSE_FILE_MAX
+#define CP_RESPONSE_FILE_MAX 1024
+#endif
+#if !defined(CP_NO_MALLOC) && (defined(__unix__) || defined(__APPLE__))
+#define CP__HAS_MMAP
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#if defined(__unix__) || defined(__APPLE__)
+#define CP__HAS_WINSIZE
+#include <sys/ioctl.h>
+#include <unistd.h>
+#endif
+
+// Define "CP_ENABLE_STATS" for `Cp_Ctx.stats`, which counts what parsing does and how long it takes.
+// Without it, the counting compiles to nothing.
+#ifdef CP_ENABLE_STATS
+#include <time.h>
+#endif
+
+// Define "CP_ENABLE_BATCH" for `cp_parseBatch`, which needs POSIX threads and C11 atomics.
+#ifdef CP_ENABLE_BATCH
+#ifdef CP_NO_MALLOC
+#error "CP_ENABLE_BATCH allocates, so it can't be used together with CP_NO_MALLOC."
+#endif
+#include <pthread.h>
+#include <stdatomic.h>
+#include <unistd.h>
+#endif
+
+// `cp_tokenize` scans with AVX2 or SSE2 when the compiler targets them. Define "CP_NO_SIMD" to always use plain C.
+#if !defined(CP_NO_SIMD) && defined(__AVX2__)
+#define CP__SIMD "avx2"
+#include <immintrin.h>
+#elif !defined(CP_NO_SIMD) && defined(__SSE2__)
+#define CP__SIMD "sse2"
+#include <emmintrin.h>
+#else
+#define CP__SIMD "scalar"
+#endif
+
+// Bit scans use the compiler's builtins, MSVC's intrinsics or plain C, see `cp__ctz64`.
+#if !defined(__GNUC__) && defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+// Amount of `uint64_t` words `Cp_Ctx.seen` needs for `optc` options.
+#define CP_OPTION_WORDS(optc) (((size_t)(optc) + 63) / 64)
+// Contexts track whether up to this many options were given without any extra storage.
+#define CP_SEEN_INLINE 256
+
+// Amount of `uint64_t` words `Cp_Ctx.argument_bits` needs for `argc` arguments.
+#define CP_ARGUMENT_WORDS(argc) (((size_t)(argc) + 63) / 64)
+
 #define CP_NUMBER_INVALID (0.0/0.0)
 #define CpNumberIsValid(number) ((number) == (number))
 
 // internal usage
 #define cp__streq(str1, str2) (strcmp(str1, str2) == 0)
+// options that take no value on the command line
+#define cp__isFlag(kind) ((kind) == OPTK_BOOL || (kind) == OPTK_COUNT)
 
 #ifdef __cplusplus
 extern "C" {
@@ -77,9 +158,21 @@ extern "C" {
 
 typedef enum {
     OPTK_BOOL,
-    OPTK_NUMBER,
-    OPTK_STRING
+    OPTK_NUMBER, // kept for compatibility, same as `OPTK_DOUBLE`
+    OPTK_STRING,
+    OPTK_INT64,  // holder is `int64_t`
+    OPTK_UINT64, // holder is `uint64_t`
+    OPTK_DOUBLE, // holder is `double`
+    OPTK_STRING_LIST, // holder is a `Cp_List` of `char*`, every occurrence of the option adds one
+    OPTK_NUMBER_LIST, // holder is a `Cp_List` of `double`
+    OPTK_ENUM,        // holder is `int64_t`, set to the value of the choice given by name
+    OPTK_COUNT        // holder is `int64_t`, a flag adding one every time it is given, so `-vvv` makes 3
 } Cp_Opt_Kind;
+// One of the names an `OPTK_ENUM` option accepts and the value it stands for, e.g. `{"fast", MODE_FAST}`.
+typedef struct {
+    const char *name;
+    int64_t value;
+} Cp_Choice;
 typedef struct {
     void *holder;
     Cp_Opt_Kind kind;
@@ -87,44 +180,485 @@ typedef struct {
     const char short_name;
     char *short_desc;
     void *user_data;
+    // Optional, environment variable `cp_applyEnv` takes the value from when the option was not given.
+    const char *env;
+    // Optional, printed by `cp_usage` under `short_desc` and wrapped the same way.
+    const char *long_desc;
+    // Choices of an `OPTK_ENUM` option, ended by one with a NULL name.
+    const Cp_Choice *choices;
 } Cp_Opt;
+// Holder of an option stored in a record instead of a variable, see `Cp_Ctx.record` and `cp_parseInto`.
+// E.g. `{CP_FIELD(Job, name), OPTK_STRING, "name", 'n'}`
+#define CP_FIELD(type, member) ((void*)offsetof(type, member))
+
+// Values of a list option, stored next to each other in `items`.
+// Zeroed, it grows by doubling and must be released with `cp_freeList`.
+// To fill a caller-owned array instead, point `items` at it, set `cap` and `fixed`;
+// it is then never reallocated and an option given more than `cap` times is an error.
+typedef struct {
+    void *items; // `char**` or `double*` depending on the kind
+    size_t count;
+    size_t cap;
+    bool fixed;
+} Cp_List;
+
+// One parsed value of any kind, used when values go to `ctx->valuev` instead of to the holders.
+typedef union {
+    bool boolean;
+    double number; // `OPTK_NUMBER` and `OPTK_DOUBLE`
+    char *string;
+    int64_t int64; // `OPTK_INT64`, `OPTK_ENUM` and `OPTK_COUNT`
+    uint64_t uint64;
+    Cp_List list;
+} Cp_Value;
+
+// internal usage
+// Open-addressing hash table over a set of names, stores `index+1` in `slots` so 0 means empty.
+typedef struct {
+    const char **names;
+    uint32_t *lens;
+    uint32_t *slots;
+    uint32_t mask;
+    uint32_t count;
+} Cp__NameTable;
+
+// Immutable lookup index for an option table, built once by `cp_compileOpts`.
+// Assign it to `ctx->schema` so `cp_parseUntil` does a hash lookup per `--name` instead of scanning `optv`.
+// It only reads `optv`, so a single schema can be shared by any amount of contexts using the same table.
+typedef struct Cp_Schema {
+    Cp_Opt *optv;
+    uintmax_t optc;
+    Cp__NameTable longs;
+    // indexed like `optv`, options without `env` are left out
+    Cp__NameTable envs;
+    // indexed like `optv`, the choices of every `OPTK_ENUM` option. NULL when the storage had no room for them.
+    Cp__NameTable *choices;
+    // `index+1` of the option owning each short name, 0 when no option uses it.
+    uint32_t shorts[256];
+} Cp_Schema;
+// Bytes of storage `cp_compileOptsInto` needs for `optc` options.
+size_t cp_schemaSize(uintmax_t optc);
+// Builds the schema inside of `storage`, which must be at least `cp_schemaSize(optc)` bytes and aligned for a pointer.
+// Returns NULL if `storage` is too small or if two options share the same long or short name.
+Cp_Schema *cp_compileOptsInto(void *storage, size_t size, uintmax_t optc, Cp_Opt optv[]);
+// Extra bytes `cp_compileOptsInto` needs past `cp_schemaSize(optc)` to hash the choices of `OPTK_ENUM` options as well.
+// Without them choices are compared one by one. `cp_compileOpts` always hashes them.
+// With them, a schema is not built if an option has the same choice twice.
+size_t cp_choicesSize(uintmax_t optc, const Cp_Opt optv[]);
+#ifndef CP_NO_MALLOC
+// Returns NULL on allocation failure or if two options share the same long or short name.
+Cp_Schema *cp_compileOpts(uintmax_t optc, Cp_Opt optv[]);
+void cp_freeSchema(Cp_Schema *schema);
+#endif
+
+// Prebuilt set of subcommand names, built once by `cp_compileSubcommands` and passed to `cp_parseUntilSet`.
+typedef struct Cp_SubcmdSet {
+    Cp__NameTable names;
+} Cp_SubcmdSet;
+// The set keeps pointers to the names, so they must outlive it.
+size_t cp_subcommandsSize(uintmax_t subcommandc);
+// Same rules as `cp_compileOptsInto`, returns NULL if `storage` is too small or if a name is present twice.
+Cp_SubcmdSet *cp_compileSubcommandsInto(void *storage, size_t size, uintmax_t subcommandc, const char *subcommandv[]);
+#ifndef CP_NO_MALLOC
+// Returns NULL on allocation failure or if a name is present twice.
+Cp_SubcmdSet *cp_compileSubcommands(uintmax_t subcommandc, const char *subcommandv[]);
+void cp_freeSubcommands(Cp_SubcmdSet *set);
+#endif
+// Index of `name` inside of the `subcommandv` the set was compiled from, or -1.
+int cp_findSubcommand(const Cp_SubcmdSet *set, const char *name);
+
+typedef enum {
+    CP_ERR_NONE,
+    CP_ERR_UNKNOWN_LONG,
+    CP_ERR_UNKNOWN_SHORT,
+    CP_ERR_BOOL_TAKES_NO_VALUE,
+    CP_ERR_MISSING_VALUE,
+    CP_ERR_EXPECTED_ASSIGN,
+    CP_ERR_SHORT_NOT_ISOLATED,
+    CP_ERR_NOT_A_NUMBER,
+    CP_ERR_NUMBER_RANGE,
+    CP_ERR_UNKNOWN_KIND,
+    CP_ERR_RESPONSE_FILE_DEPTH,
+    CP_ERR_RESPONSE_FILE_COUNT,
+    CP_ERR_OUT_OF_MEMORY,
+    CP_ERR_LIST_FULL,
+    CP_ERR_TOO_MANY_ARGUMENTS,
+    CP_ERR_NOT_A_BOOL,
+    CP_ERR_UNKNOWN_KEY,
+    CP_ERR_CONFIG_SYNTAX,
+    CP_ERR_CONFIG_OPEN,
+    CP_ERR_UNKNOWN_CHOICE,
+    CP_ERR_MISSING_OPTION,
+    CP_ERR_EXCLUSIVE_OPTIONS,
+    CP_ERR_REQUIRED_BY,
+    CP_ERR_TOO_MANY_TIMES,
+    CP_ERR_COUNT
+} Cp_Err_Code;
+// What went wrong, recorded without formatting anything. Use `cp_formatError` to get a message.
+typedef struct {
+    Cp_Err_Code code;
+    int argi;   // index in `argv` of the offending argument, -1 for the environment and -2 for a config file
+    int opt;    // index in `optv` of the option involved, -1 if none
+    int offset; // byte offset inside of `argv[argi]` where the problem starts
+    const char *arg; // `argv[argi]` itself or the "NAME=value" environment entry, NULL if there was nothing to blame
+    int line;        // 1-based line of the config file when `argi` is -2
+    int other;       // index in `optv` of the second option of a broken `Cp_Rule`, -1 if none
+} Cp_Error;
+
+// Constraint on a group of options, checked once parsing is done. Options are given by their index in `optv`.
+typedef enum {
+    CP_RULE_REQUIRED,  // every option of the group must be given
+    CP_RULE_EXCLUSIVE, // at most one option of the group may be given
+    CP_RULE_REQUIRES,  // when the first option of the group is given, all the others must be too
+    CP_RULE_AT_MOST    // no option of the group may be given more than `max` times, needs `Cp_Ctx.counts`
+} Cp_Rule_Kind;
+typedef struct {
+    Cp_Rule_Kind kind;
+    uintmax_t optc;
+    const int *optv;
+    uint32_t max;
+} Cp_Rule;
+// Rules turned into one bit mask per group by `cp_compileRules`, so checking them takes a few word operations
+// instead of comparing options with each other. Assign it to `ctx->rules`.
+typedef struct Cp_Rules {
+    uintmax_t optc;
+    uintmax_t rulec;
+    const Cp_Rule *rulev;
+    size_t words;       // `CP_OPTION_WORDS(optc)`, the size of every mask
+    uint64_t *required; // options some `CP_RULE_REQUIRED` names
+    uint64_t *masks;    // `words` per rule, without the first option for `CP_RULE_REQUIRES`
+    uint32_t *spans;    // first and past the last word of every mask with a bit set, so sparse rules stay short
+} Cp_Rules;
+// Bytes of storage `cp_compileRulesInto` needs for `rulec` rules over `optc` options.
+size_t cp_rulesSize(uintmax_t optc, uintmax_t rulec);
+// Same rules as `cp_compileOptsInto`. Returns NULL if `storage` is too small, if a rule names an option
+// past `optc` or if a `CP_RULE_REQUIRES` names less than two. The rules must outlive it.
+Cp_Rules *cp_compileRulesInto(void *storage, size_t size, uintmax_t optc, uintmax_t rulec, const Cp_Rule rulev[]);
+#ifndef CP_NO_MALLOC
+Cp_Rules *cp_compileRules(uintmax_t optc, uintmax_t rulec, const Cp_Rule rulev[]);
+void cp_freeRules(Cp_Rules *rules);
+#endif
+
+#ifdef CP_ENABLE_STATS
+struct Cp_Ctx;
+// Counters `Cp_Ctx.stats` adds to, zero it before pointing a context at it. It may be shared by contexts
+// parsing one after another, and adds up over all of them. Parsers from `cp_generateParser` only count hits and errors.
+typedef struct {
+    uint64_t tokens;      // arguments parsed, including option values and `cp_feed` tokens
+    uint64_t bytes;       // length of those arguments
+    uint64_t comparisons; // option and subcommand names compared, one per probe with a schema or set
+    uint64_t conversions; // values converted to numbers
+    uint64_t parse_ns;    // time spent in `cp_parseUntil` and its siblings, on a monotonic clock
+    uint64_t errors[CP_ERR_COUNT];
+    // Optional, `optc` counters of how many times each option got a value.
+    uint64_t *hits;
+    // Optional, called with every argument before it is parsed.
+    void (*on_token)(const struct Cp_Ctx *ctx, const char *arg, void *user_data);
+    void *user_data;
+} Cp_Stats;
+#endif
 
-#define CP_PARSE_ERR_LEN 1024
 typedef struct Cp_Ctx {
-    char err[CP_PARSE_ERR_LEN];
     char **argv;
+    int argc;
+    int argi; // internal index for where we are in argv
+    // internal usage, state kept between arguments so they can also be fed one at a time with `cp_feed`
+    const char *arg; // argument being parsed
+    int pending;     // index+1 in `optv` of the option waiting for its value in the next argument, 0 if none
+    bool halted;     // "--" was seen with `dashdash_halt`, so everything after it is an argument
+    Cp_Opt *optv;
+    uintmax_t optc;
+    // Optional, must be compiled from `optv`. When NULL, options are found by a linear scan.
+    const Cp_Schema *schema;
     // Stores arguments such as file names in a compiler.
     // E.g.
     // `./app -myopt=AAAAAAAAAA file1.c file2.c`
     // `------------------------^^^^^^^^^^^^^^^` those are stored inside `argumentv`.
     // `argumentv` only considers stuff *after* the `subcommand` as arguments.
+    // Going past `argumentcap` is an error, unless `argumentv` is NULL and arguments are just counted.
     char **argumentv;
-    Cp_Opt *optv;
-    const char *app_name;
-    uintmax_t optc;
-    int argc;
-    int argi; // internal index for where we are in argv
     int argumentc;
     int argumentcap;
+    // Set by `cp_parseCommand`, `argumentv` from this index on belongs to the command the walk ended at.
+    int command_argument;
+    // Optional, replaces `argumentv`: bit `i % 64` of word `i / 64` tells whether `argv[i]` is an argument.
+    // Must hold `CP_ARGUMENT_WORDS(argc)` words, which don't need to be zeroed, and has no cap.
+    // Walk it with `cp_nextArgument`. With response files the context switches to bits of its own.
+    uint64_t *argument_bits;
+    Cp_Error err;
+    // Bit `i` is set once option `i` got a value, so `cp_applyEnv` leaves it alone. Read it with `cp_seen`.
+    // Tables of up to CP_SEEN_INLINE options use `seen_inline`, `cp_newCtx` allocates the bits for bigger ones.
+    // Otherwise point `seen` at `CP_OPTION_WORDS(optc)` zeroed words. Without them nothing is tracked,
+    // so `cp_applyEnv` would override options given on the command line.
+    // `cp_parseCommand` reuses them for every subcommand, and allocates bigger ones when a table needs more.
+    uint64_t *seen;
+    uint64_t seen_inline[CP_SEEN_INLINE / 64];
+    // Optional, `optc` zeroed counters of how many times each option got a value.
+    uint32_t *counts;
+    // Optional, compiled for `optv`. Checked when `cp_parseUntil` or `cp_finish` is done,
+    // so with options coming from later layers leave it NULL and call `cp_checkRules` after them.
+    const Cp_Rules *rules;
+    // Optional, `optc` slots. When set, option `i` is stored in `valuev[i]` and `holder` is left untouched,
+    // so contexts sharing the same `optv` can parse at the same time.
+    Cp_Value *valuev;
+    // Optional, struct the options are stored in. When set, every `holder` is an offset made with `CP_FIELD`,
+    // so a single table, and schema, can fill any amount of records. `valuev` takes precedence.
+    void *record;
+    const char *app_name;
     bool dashdash_halt;
+    // Expands "@file" arguments into the arguments written inside of `file`, the same way GCC does.
+    // `argv` and `argc` then describe the expanded arguments and string values point into the file,
+    // so they stay valid until the context is freed or released. Ignored with CP_NO_MALLOC.
+    bool response_files;
+    // internal usage, owned by the context once response files were expanded or a config file was read
+    char **resp_argv;
+    uint64_t *resp_bits;
+    uint64_t *user_bits; // the caller's `argument_bits` while `resp_bits` stands in for them
+    uint64_t *seen_owned; // `seen` grown by `cp_parseCommand`, kept until the context is released
+    size_t seen_words;    // how many words `seen` holds, 0 when it is the `CP_OPTION_WORDS(optc)` of the first table
+    struct Cp__File *files;
+    const char *config_path;
+#ifdef CP_ENABLE_STATS
+    // Optional, see `Cp_Stats`.
+    Cp_Stats *stats;
+#endif
 } Cp_Ctx;
+// Sets up a context on storage owned by the caller, e.g. on the stack. Nothing has to be freed afterwards.
+bool cp_initCtx(Cp_Ctx *ctx, int argc, char *argv[], uintmax_t optc, Cp_Opt optv[], int argumentcap, char *argumentv[]);
+// Gets `ctx` ready to parse another argv, keeping its options, schema, `argumentv` buffer and settings.
+// Response and config files of the previous parse are released and `argument_bits` is the caller's again.
+void cp_resetCtx(Cp_Ctx *ctx, int argc, char *argv[]);
+#ifndef CP_NO_MALLOC
 Cp_Ctx *cp_newCtx(int argc, char *argv[], uintmax_t optc, Cp_Opt optv[], int argumentcap, char *argumentv[]);
 void cp_freeCtx(Cp_Ctx *ctx);
+// Unmaps the response and config files of a context set up by `cp_initCtx` and gives `argument_bits` back to the caller,
+// `cp_freeCtx` already does this.
+// Call it before setting the same storage up again.
+void cp_releaseCtx(Cp_Ctx *ctx);
+#endif
+
+// Whether option `opt` (its index in `optv`) was given a value.
+bool cp_seen(const Cp_Ctx *ctx, int opt);
+// Checks `rules`, compiled for `ctx->optv`, against the options seen so far and reports the first one broken
+// in `ctx->err`. Nothing is tracked for tables past CP_SEEN_INLINE options without `seen`, which then always pass.
+bool cp_checkRules(Cp_Ctx *ctx, const Cp_Rules *rules);
+// Fills every option that has an `env` name and was not given yet from the environment, in a single pass
+// over `envp` (`environ` when NULL). Values are parsed like on the command line; booleans take
+// 1/0, true/false, yes/no and on/off. Options with a value don't get another one from a later layer.
+// With a schema, names are hashed once per variable, otherwise each option looks its variable up.
+bool cp_applyEnv(Cp_Ctx *ctx, char **envp);
+// Sets options from a config file of "key = value" lines. A "[section]" header makes the keys after it
+// "section.key", matched against the long names. '#' and ';' start comment lines, a bool key may stand alone
+// and values may be wrapped in quotes to keep surrounding spaces. Inside of the file the last value wins,
+// and list options take every value, but options given by an earlier layer are left alone.
+// Call `cp_parse`, then `cp_applyEnv`, then this, so precedence is defaults < file < environment < command line.
+// Keys, values and the quotes around them are terminated in place and string values point into `text`,
+// whose `text[len]` must be writable. With CP_NO_MALLOC and more than CP_SEEN_INLINE options,
+// the first value of a key wins instead.
+bool cp_parseConfig(Cp_Ctx *ctx, char *text, size_t len);
+#ifndef CP_NO_MALLOC
+// Same as `cp_parseConfig` on a private mapping of `path`, which stays mapped until the context is freed or released.
+bool cp_parseConfigFile(Cp_Ctx *ctx, const char *path);
+#endif
+
+#ifndef CP_NO_MALLOC
+// Frees the items of a list that grew by itself and empties it, a `fixed` list only gets emptied.
+void cp_freeList(Cp_List *list);
+#endif
+
+// Renders `ctx->err` into `buf`, returns the same as `snprintf`.
+int cp_formatError(const Cp_Ctx *ctx, char *buf, size_t len);
+// What the messages of `cp_formatError` name, for front ends that keep their options out of a `Cp_Ctx`.
+typedef struct {
+    const char *opt_name;      // of `err->opt`, NULL if none
+    const char *opt_kind;      // what its values are, e.g. "int64", NULL if none
+    const char *other_name;    // of `err->other`, NULL if none
+    const char *config_path;   // of the config file `err` comes from
+    int argumentcap;           // for CP_ERR_TOO_MANY_ARGUMENTS
+    unsigned count;            // times `err->opt` was given, for CP_ERR_TOO_MANY_TIMES
+    const Cp_Choice *choices;  // of `err->opt`, for CP_ERR_UNKNOWN_CHOICE
+} Cp_Error_Info;
+// Renders `err` with the names in `info` into `buf`, with the messages of `cp_formatError`.
+int cp_formatErrorInfo(const Cp_Error *err, const Cp_Error_Info *info, char *buf, size_t len);
 
 // Default "help" function. Is not called by the library and is only implemented for utility.
+// Renders the help at the width of the terminal `file` is, and writes it with a single `fwrite`.
+// With CP_NO_MALLOC, help longer than 4096 bytes is cut there, use `cp_renderHelp` with a bigger buffer instead.
 // Define "CLI_PARSER_CUSTOM_USAGE" to disable "cp_usage"'s implementation and implement a usage function yourself.
 // Check "cp_usage"'s implementation for an example on how to implement a usage function.
 void cp_usage(Cp_Ctx *ctx, FILE *file);
+// Columns of the terminal `file` is (stdout or stderr), from `COLUMNS` or the terminal itself, 80 if unknown.
+int cp_helpWidth(FILE *file);
+// Renders the help `cp_usage` prints, wrapped to `width` columns, into `buf`. Returns the length of the
+// whole text like `snprintf` does, so calling it with a `size` of 0 tells how big `buf` has to be.
+// With a schema, the name lengths come from it instead of being measured again.
+size_t cp_renderHelp(const Cp_Ctx *ctx, int width, char *buf, size_t size);
+#ifndef CP_NO_MALLOC
+// Help text rendered once and kept for later calls, e.g. by tools asking for `--help` over and over.
+// Zero it before its first use and release it with `cp_freeHelp`.
+typedef struct {
+    char *text;
+    size_t len;
+    int width;
+} Cp_Help;
+// Renders the help of `ctx` into `help` unless it already holds it at this `width`, and returns the text.
+// A `help` belongs to one option table, zero it again after changing the table.
+// `len` may be NULL. Returns NULL on allocation failure.
+const char *cp_helpText(Cp_Help *help, const Cp_Ctx *ctx, int width, size_t *len);
+void cp_freeHelp(Cp_Help *help);
+#endif
+
+// Long and short option names and subcommands in sorted order, so completion finds the ones starting with a
+// prefix by a binary search. Worth it for programs answering many queries; one started for every Tab press spends
+// more time sorting than `cp_complete` spends scanning the names.
+typedef struct {
+    const char *name;
+    uint32_t len;
+    uint32_t id; // index in `optv` or in `subcommandv`
+} Cp__Completion_Entry;
+typedef struct Cp_CompletionIndex {
+    Cp__Completion_Entry *longs;
+    uint32_t longc;
+    Cp__Completion_Entry *shorts; // names of a single byte pointing into `optv`
+    uint32_t shortc;
+    Cp__Completion_Entry *subcommands;
+    uint32_t subcommandc;
+} Cp_CompletionIndex;
+size_t cp_completionSize(uintmax_t optc, uintmax_t subcommandc);
+// Keeps pointers to the names and into `optv`, so they must outlive it. Returns NULL if `storage` is too small.
+Cp_CompletionIndex *cp_compileCompletionInto(void *storage, size_t size, uintmax_t optc, const Cp_Opt optv[], uintmax_t subcommandc, const char *subcommandv[]);
+#ifndef CP_NO_MALLOC
+Cp_CompletionIndex *cp_compileCompletion(uintmax_t optc, const Cp_Opt optv[], uintmax_t subcommandc, const char *subcommandv[]);
+void cp_freeCompletion(Cp_CompletionIndex *index);
+#endif
+
+#define CP_COMPLETE_COMMAND "__complete"
+// Answers shell completion before anything gets parsed. When `argv[1]` is CP_COMPLETE_COMMAND, writes to `out`
+// the candidates for the last of the words after it, one "candidate\tshort_desc" line each, and returns how many.
+// Returns -1 for any other argv, which the program then parses as usual. E.g. `app __complete --na` gives "--name".
+// "--x" completes long options, "-" short and long ones and other words subcommands. A word following an option
+// waiting for its value, a subcommand or a halting "--" gets nothing, so the shell falls back to file names.
+// Without `index` the options are scanned in table order, otherwise the candidates come sorted.
+int cp_complete(const Cp_Ctx *ctx, const Cp_CompletionIndex *index, uintmax_t subcommandc, const char *subcommandv[], FILE *out);
 
 // internal usage
-bool cp__parseLongOpt(Cp_Ctx *ctx, Cp_Opt opt);
-bool cp__parseShortOpt(Cp_Ctx *ctx, Cp_Opt opt, int arg_amount);
+bool cp__parseLongOpt(Cp_Ctx *ctx, const Cp_Opt *opt, const char *arg, size_t name_len, size_t value_len);
+bool cp__setValue(Cp_Ctx *ctx, const Cp_Opt *opt, const char *value);
+bool cp__setValueLen(Cp_Ctx *ctx, const Cp_Opt *opt, const char *value, size_t len);
+bool cp__awaitValue(Cp_Ctx *ctx, const Cp_Opt *opt);
+bool cp__fail(Cp_Ctx *ctx, Cp_Err_Code code, const Cp_Opt *opt, int offset);
+void *cp__holder(const Cp_Ctx *ctx, const Cp_Opt *opt);
+bool cp__parseShortOpt(Cp_Ctx *ctx, const Cp_Opt *opt, const char *arg, int pos, size_t value_len);
+void cp__markSeen(Cp_Ctx *ctx, const Cp_Opt *opt);
+bool cp__storeArgument(Cp_Ctx *ctx, const char *arg);
 
 int cp_parseUntil(Cp_Ctx *ctx, uintmax_t subcommandc, const char *subcommandv[]);
+// Same as `cp_parseUntil` but looks subcommands up in a prebuilt set, which stays fast with many subcommands.
+int cp_parseUntilSet(Cp_Ctx *ctx, const Cp_SubcmdSet *set);
 int cp_parse(Cp_Ctx *ctx);
+// Parses `argv` into `record`, the struct the `CP_FIELD` holders of the options `schema` was compiled from point into.
+// The context only lives for the call, so one schema can fill arrays of records and be used by many threads at once.
+// Positional arguments are counted but not kept, set `Cp_Ctx.record` on a context of your own to get them.
+// Returns the amount of positional arguments, or -1 with the error in `err` when it is not NULL.
+int cp_parseInto(const Cp_Schema *schema, int argc, char *argv[], void *record, Cp_Error *err);
+
+// One level of a command tree such as `git remote add`, walked by `cp_parseCommand`.
+// E.g. `Cp_Command add = {"add", 2, add_opts, .handler = run_add};`
+typedef struct Cp_Command {
+    const char *name; // what selects it after its parent, ignored for the root
+    uintmax_t optc;
+    Cp_Opt *optv;
+    uintmax_t subc;
+    const struct Cp_Command *subv;
+    // Optional, called by `cp_runCommand` when the walk ends at this command. Returns the exit status.
+    int (*handler)(Cp_Ctx *ctx, const struct Cp_Command *command);
+    // Optional, compiled from `optv` and from the names in `subv` in the same order.
+    const Cp_Schema *schema;
+    const Cp_SubcmdSet *set;
+    void *user_data;
+    // Optional, compiled from `optv` and checked once the walk is past this command.
+    const Cp_Rules *rules;
+} Cp_Command;
+// Parses `ctx->argv` through the tree of `root` in a single pass with the one context. Options apply to the
+// command whose arguments they are among, and a word naming a subcommand moves the rest of argv to it.
+// Returns the command the walk ended at, or NULL when parsing failed.
+// `ctx` takes the tables of each command in turn, `cp_seen` then refers to the last one; as the tables
+// share indices, `valuev` can't be used and `counts` is zeroed for every command, so it must fit the
+// biggest table. Arguments of every level go to `argumentv` in order, those of the last command start
+// at `ctx->command_argument`.
+const Cp_Command *cp_parseCommand(Cp_Ctx *ctx, const Cp_Command *root);
+// Same as `cp_parseCommand`, then calls the handler of the command it ended at and returns what it returned.
+// Returns -1 when parsing failed or when that command has no handler, which leaves `ctx->err.code` at CP_ERR_NONE.
+int cp_runCommand(Cp_Ctx *ctx, const Cp_Command *root);
+// Positional arguments of the command `cp_parseCommand` ended at, e.g. in a handler called by `cp_runCommand`:
+// `*count` of them from the returned pointer on, which is NULL when they are only counted.
+// Those of the commands above it are the `ctx->command_argument` ones before them in `argumentv`.
+char **cp_commandArguments(const Cp_Ctx *ctx, int *count);
+// Index in `ctx->argv` of the first argument from `from` on, or -1. Needs `argument_bits`.
+// E.g. `for(int i = cp_nextArgument(ctx, 0); i >= 0; i = cp_nextArgument(ctx, i+1))`.
+int cp_nextArgument(const Cp_Ctx *ctx, int from);
+
+// Push-style parsing for arguments that arrive one at a time, e.g. NUL-separated over a pipe.
+// Set the context up with `argc` 0 and `argv` NULL, feed every argument, then call `cp_finish`.
+// `token[len]` must be a NUL. Nothing is copied: string values and `argumentv` point into `token`,
+// as does `ctx->err` until the next call. Response files and subcommands are not looked at.
+// Returns 1 when `token` is a positional argument, which also goes in `argumentv` while there is room,
+// 0 when it was an option or the value of one and -1 on error.
+int cp_feed(Cp_Ctx *ctx, const char *token, size_t len);
+// Fails if the last option fed is still waiting for its value.
+bool cp_finish(Cp_Ctx *ctx);
+
+// Splits a command line into arguments like a POSIX shell would, without expanding anything:
+// whitespace separates arguments, single quotes keep everything literally, double quotes keep everything
+// but a backslash before $ ` " \ or a newline, and outside of quotes a backslash escapes any character.
+// Arguments are unquoted and NUL-terminated in place, `str[len]` must be writable as the last one may end there.
+// Returns the amount of arguments put in `argv`, -1 if there are more than `argcap`
+// or -2 on an unterminated quote.
+int cp_tokenize(char *str, size_t len, int argcap, char *argv[]);
+
+#ifdef CP_ENABLE_BATCH
+// Amount of lines in `buf`, a separator right at the end does not start another line.
+size_t cp_countLines(const char *buf, size_t len, char separator);
+// Parses every line of `buf` against `schema`, spread over `threadc` threads (0 means one per core).
+// Lines are split by `separator`, usually '\n' or '\0', then into arguments on whitespace, writing NULs into `buf`.
+// Line `i` gets its values in `valuev[i*schema->optc]` onwards, which are zeroed first, and its status in `errv[i]`.
+// String values point into `buf`, and `buf[len]` must be a NUL so the last line ends even without a separator.
+// Returns the amount of lines, or -1 if there are more than `linecap`
+// or the threads could not be started.
+long cp_parseBatch(
+    const Cp_Schema *schema, char *buf, size_t len, char separator, int threadc,
+    size_t linecap, Cp_Value valuev[], Cp_Error errv[]
+);
+#endif
+
+#ifdef CP_ENABLE_CODEGEN
+// Writes the C source of a parser specialized for `optv`, whose functions are named `<prefix>_parse`
+// and `<prefix>_parseUntil` and work like `cp_parse` and `cp_parseUntil` on a context made for that same table.
+// They compare the context's table against `optv` on every call and hand any other table to `cp_parseUntil`.
+// Long names are found by a hash over their length and a few bytes picked for the table, short names by a
+// 256 entry table, and values are parsed by the routine of their kind.
+// The generated file only needs cli-parser.h, as the implementation is linked from elsewhere.
+// Returns false if `prefix` is not a C identifier, if two options share a name or on a write error.
+bool cp_generateParser(FILE *out, const char *prefix, uintmax_t optc, const Cp_Opt optv[]);
+#endif
 
 // internal usage
-bool cp__strHasPrefix(const char *str, const char *prefix);
+typedef enum {
+    CP__NUM_OK,
+    CP__NUM_INVALID,
+    CP__NUM_RANGE
+} Cp__Num_Status;
+Cp__Num_Status cp__parseInt64(const char *str, size_t len, int64_t *out);
+Cp__Num_Status cp__parseUint64(const char *str, size_t len, uint64_t *out);
+Cp__Num_Status cp__parseDouble(const char *str, size_t len, double *out);
+
+// internal usage
+uint32_t cp__hash(const char *str, size_t len);
+uint32_t cp__hashStr(const char *str, size_t *len);
+size_t cp__nameLen(const char *arg, uint32_t *hash);
+int cp__tableFind(const Cp__NameTable *table, const char *name, size_t len, uint32_t hash);
+int cp__findLongOpt(const Cp_Ctx *ctx, const char *name, size_t len, uint32_t hash);
+int cp__findShortOpt(const Cp_Ctx *ctx, char short_name);
 
 
 #ifdef __cplusplus
@@ -132,397 +666,3412 @@ bool cp__strHasPrefix(const char *str, const char *prefix);
 #endif 
 
 #ifdef CLI_PARSER_IMPLEMENTATION
-bool cp__strHasPrefix(const char *str, const char *prefix) {
-    if(str == NULL || prefix == NULL) {
-        return false;
-    }
-    int str_len = strlen(str); // perfect naming
-    int prefix_len = strlen(prefix);
-    if(prefix_len > str_len) {
-        return false;
-    }
 
-    for(int i = 0; i < prefix_len; ++i) {
-        if(str[i] != prefix[i]) { 
-            return false;
-        }
+// internal usage
+// Instrumentation for `Cp_Ctx.stats`. Every use is a statement of its own line, so without
+// CP_ENABLE_STATS the code is the same as if they were not there.
+#ifdef CP_ENABLE_STATS
+#define CP__STAT(ctx, field, amount) do { if((ctx)->stats != NULL) (ctx)->stats->field += (amount); } while(0)
+#define CP__STAT_HIT(ctx, opt) do { if((ctx)->stats != NULL && (ctx)->stats->hits != NULL) ++(ctx)->stats->hits[(opt) - (ctx)->optv]; } while(0)
+#define CP__STAT_TOKEN(ctx, arg, len) do { if((ctx)->stats != NULL) cp__statToken(ctx, arg, len); } while(0)
+#define CP__PARSE_UNTIL cp__parseUntilTimed
+#else
+#define CP__STAT(ctx, field, amount) ((void)0)
+#define CP__STAT_HIT(ctx, opt) ((void)0)
+#define CP__STAT_TOKEN(ctx, arg, len) ((void)0)
+#define CP__PARSE_UNTIL cp__parseUntil
+#endif
+
+// Index of the lowest set bit, `bits` must not be 0.
+static inline int cp__ctz64(uint64_t bits) {
+#if defined(__GNUC__)
+    return __builtin_ctzll(bits);
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_ARM64))
+    unsigned long i;
+    _BitScanForward64(&i, bits);
+    return (int)i;
+#else
+    int i = 0;
+    while((bits & 1) == 0) {
+        bits >>= 1;
+        ++i;
     }
-    return true;
+    return i;
+#endif
+}
+static inline int cp__ctz32(uint32_t bits) {
+#if defined(__GNUC__)
+    return __builtin_ctz(bits);
+#elif defined(_MSC_VER)
+    unsigned long i;
+    _BitScanForward(&i, bits);
+    return (int)i;
+#else
+    return cp__ctz64(bits);
+#endif
+}
+static inline int cp__popcount32(uint32_t bits) {
+#if defined(__GNUC__)
+    return __builtin_popcount(bits);
+#else
+    bits = bits - ((bits >> 1) & 0x55555555u);
+    bits = (bits & 0x33333333u) + ((bits >> 2) & 0x33333333u);
+    return (int)((((bits + (bits >> 4)) & 0x0F0F0F0Fu) * 0x01010101u) >> 24);
+#endif
 }
 
-Cp_Ctx *cp_newCtx(int argc, char *argv[], uintmax_t optc, Cp_Opt optv[], int argumentcap, char *argumentv[]) {
-    if(
-        optc == 0 ||
-        optv == NULL ||
-        argc < 1 ||
-        argv == NULL
-    ) {
-        return NULL;
+// FNV-1a, good enough for option names and cheap to compute while scanning.
+uint32_t cp__hash(const char *str, size_t len) {
+    uint32_t hash = 2166136261u;
+    for(size_t i = 0; i < len; ++i) {
+        hash = (hash ^ (unsigned char)str[i]) * 16777619u;
     }
-    
-    Cp_Ctx *ctx = calloc(1, sizeof(Cp_Ctx));
-    if(ctx == NULL) {
-        return NULL;
+    return hash;
+}
+
+// Hashes a whole NUL-terminated string, storing its length in `len`.
+uint32_t cp__hashStr(const char *str, size_t *len) {
+    uint32_t hash = 2166136261u;
+    size_t i = 0;
+    for(; str[i] != '\0'; ++i) {
+        hash = (hash ^ (unsigned char)str[i]) * 16777619u;
     }
+    *len = i;
+    return hash;
+}
 
-    ctx->argc = argc;
-    ctx->argv = argv;
+// Length of the option name at the start of `arg`, which ends at '=', ':' or the end of the string.
+// Hashes the name on the way so every byte of it is only read once.
+size_t cp__nameLen(const char *arg, uint32_t *hash) {
+    uint32_t h = 2166136261u;
+    size_t len = 0;
+    for(; arg[len] != '\0' && arg[len] != '=' && arg[len] != ':'; ++len) {
+        h = (h ^ (unsigned char)arg[len]) * 16777619u;
+    }
+    *hash = h;
+    return len;
+}
 
-    ctx->optc = optc;
-    ctx->optv = optv;
+// internal usage
+typedef enum {
+    CP__TOKEN_POSITIONAL,
+    CP__TOKEN_SHORT,    // "-abc", including a lone "-"
+    CP__TOKEN_LONG,     // "--name", "--name=value" or "--name:value"
+    CP__TOKEN_DASHDASH  // just "--"
+} Cp__Token_Kind;
 
-    ctx->argumentcap = argumentcap;
-    ctx->argumentv = argumentv;
+// What an argument is, found with a single look at it which matching then builds on.
+typedef struct {
+    Cp__Token_Kind kind;
+    uint32_t hash;   // of the long name
+    size_t name_len; // of the long name after the "--", the delimiter if any is right after it
+} Cp__Token;
 
-    return ctx;
-}
-void cp_freeCtx(Cp_Ctx *ctx) {
-    if(ctx == NULL) return;
-    free(ctx);
+// Only reads up to the end of a long name. Whatever comes after the delimiter is a value, which is left for the
+// conversions that need it, so a string value is never read at all however long it is.
+static Cp__Token cp__lexArg(const char *arg) {
+    Cp__Token token = {CP__TOKEN_POSITIONAL, 0, 0};
+    if(arg[0] != '-') {
+        return token;
+    }
+    if(arg[1] != '-') {
+        token.kind = CP__TOKEN_SHORT;
+    } else if(arg[2] == '\0') {
+        token.kind = CP__TOKEN_DASHDASH;
+    } else {
+        token.kind = CP__TOKEN_LONG;
+        token.name_len = cp__nameLen(arg + 2, &token.hash);
+    }
+    return token;
 }
 
-bool cp__parseLongOpt(Cp_Ctx *ctx, Cp_Opt opt) {
-    const char *arg = ctx->argv[ctx->argi];
-    if(cp__strHasPrefix(arg, "--")) {
-        arg+=2;
+// internal usage
+static uint32_t cp__tableSlotCount(uintmax_t count) {
+    uint32_t slots = 8;
+    while(slots < count*2) {
+        slots <<= 1;
     }
-    switch(opt.kind) {
-        case OPTK_BOOL: {
-            if(strlen(opt.name) != strlen(arg)) {
-                snprintf(
-                    ctx->err, CP_PARSE_ERR_LEN,
-                    "At argument near %d: Argument of type `bool` takes no argument.", ctx->argi
-                );
-                return false;
-            }
-            *(bool*)(opt.holder) = true;
-        } break;
-        case OPTK_STRING: {
-            int name_len = strlen(opt.name);
-            int arg_len = strlen(arg);
-            
-            if(name_len == arg_len) {
-                // the value is on the next argument
-                if((ctx->argi)+1 >= ctx->argc) {
-                    snprintf(
-                        ctx->err, CP_PARSE_ERR_LEN,
-                        "At argument near %d: Expected argument but got nothing.", ctx->argi
-                    );
-                    return false;
-                }
-                arg = ctx->argv[++ctx->argi];
-                *(char**)(opt.holder) = (char*)arg;
-                break;
-            }
-            char *assign;
-            if((assign = strchr(arg, '=')) == NULL) {
-                if((assign = strchr(arg, ':')) == NULL) {
-                    snprintf(
-                        ctx->err, CP_PARSE_ERR_LEN,
-                        "At argument near %d: Expected either '=', ':' or ' ' to set value. E.g. `flag=this flag:that`.", ctx->argi
-                    );
-                    return false;
-                }
-            }
-            ++assign;
-            *(char**)(opt.holder) = assign;
-        } break;
-        case OPTK_NUMBER: {
-            int name_len = strlen(opt.name);
-            int arg_len = strlen(arg);
-            if(name_len == arg_len) {
-                // the value is on the next argument
-                if((ctx->argi)+1 >= ctx->argc) {
-                    snprintf(
-                        ctx->err, CP_PARSE_ERR_LEN,
-                        "At argument near %d: Expected argument but got nothing.", ctx->argi
-                    );
-                    return false;
-                }
-                arg = ctx->argv[++ctx->argi];
-                double value;
-                if(sscanf(arg, "%lf", &value) != 1) {
-                    snprintf(
-                        ctx->err, CP_PARSE_ERR_LEN,
-                        "At argument near %d: Expected a number literal.", ctx->argi
-                    );
-                    return false;
-                }
-                *(double*)(opt.holder) = value;
-                break;
-            }
-            char *assign;
-            if((assign = strchr(arg, '=')) == NULL) {
-                if((assign = strchr(arg, ':')) == NULL) {
-                    snprintf(
-                        ctx->err, CP_PARSE_ERR_LEN,
-                        "At argument near %d: Expected either '=', ':' or ' ' to set value. E.g. `flag=this flag:that`.", ctx->argi
-                    );
-                    return false;
-                }
-            }
-            ++assign;
-            double value;
-            if(sscanf(assign, "%lf", &value) != 1) {
-                snprintf(
-                    ctx->err, CP_PARSE_ERR_LEN,
-                    "At argument near %d: Expected a number literal.", ctx->argi
-                );
+    return slots;
+}
+
+// `names` and `lens` must already be filled, NULL names are left out of the table.
+// Returns false if a name is present twice.
+static bool cp__tableBuild(Cp__NameTable *table) {
+    for(uint32_t i = 0; i < table->count; ++i) {
+        const char *name = table->names[i];
+        if(name == NULL) {
+            continue;
+        }
+        uint32_t len = table->lens[i];
+        uint32_t slot = cp__hash(name, len) & table->mask;
+        while(table->slots[slot] != 0) {
+            uint32_t other = table->slots[slot]-1;
+            if(table->lens[other] == len && memcmp(table->names[other], name, len) == 0) {
                 return false;
             }
-            *(double*)(opt.holder) = value;
-        } break;
-        default: {
-            strncpy(ctx->err, "Unknown option kind.", CP_PARSE_ERR_LEN);
-            return false; // in theory, unreachable
-        } break;
+            slot = (slot+1) & table->mask;
+        }
+        table->slots[slot] = i+1;
     }
-
     return true;
 }
-bool cp__parseShortOpt(Cp_Ctx *ctx, Cp_Opt opt, int arg_amount) {
-    const char *arg = ctx->argv[ctx->argi];
-    if(arg[0] == '-') {
-        ++arg;
+
+int cp__tableFind(const Cp__NameTable *table, const char *name, size_t len, uint32_t hash) {
+    uint32_t slot = hash & table->mask;
+    uint32_t entry;
+    while((entry = table->slots[slot]) != 0) {
+        --entry;
+        if(table->lens[entry] == len && memcmp(table->names[entry], name, len) == 0) {
+            return (int)entry;
+        }
+        slot = (slot+1) & table->mask;
     }
-    int arg_len = strlen(arg);
-    switch(opt.kind) {
-        case OPTK_BOOL: {
-            if(arg_amount < arg_len && (arg[arg_amount] == '=' || arg[arg_amount] == ':')) {
-                snprintf(
-                    ctx->err, CP_PARSE_ERR_LEN,
-                    "At argument near %d: Argument of type `bool` takes no argument.", ctx->argi
-                );
-                return false;
-            }
-            *(bool*)(opt.holder) = true;
-        } break;
-        case OPTK_STRING: {
-            if(arg_amount > 1) {
-                snprintf(
-                    ctx->err, CP_PARSE_ERR_LEN,
-                    "At argument near %d: Short opts can only have an argument if isolated.", ctx->argi
-                );
-                return false;
-            }
-            if(arg_amount >= arg_len) {
-                // the value is on the next argument
-                if(ctx->argi+1 >= ctx->argc) {
-                    snprintf(
-                        ctx->err, CP_PARSE_ERR_LEN,
-                        "At argument near %d: Expected argument but got nothing.", ctx->argi
-                    );
-                    return false;
-                }
-                arg = ctx->argv[++ctx->argi];
-                *(char**)(opt.holder) = (char*)arg;
-                return true;
-            }
-            char *assign;
-            if((assign = strchr(arg, '=')) == NULL) {
-                if((assign = strchr(arg, ':')) == NULL) {
-                    snprintf(
-                        ctx->err, CP_PARSE_ERR_LEN,
-                        "At argument near %d: Expected either '=', ':' or ' ' to set value. E.g. `flag=this flag:that`.", ctx->argi
-                    );
-                    return false;
-                }
-            }
-            ++assign;
-            *(char**)(opt.holder) = assign;
-            return true;
-        } break;
-        case OPTK_NUMBER: {
-            if(arg_amount > 1) {
-                snprintf(
-                    ctx->err, CP_PARSE_ERR_LEN,
-                    "At argument near %d: Short opts can only have an argument if isolated.", ctx->argi
-                );
-                return false;
-            }
-            if(arg_amount >= arg_len) {
-                // the value is on the next argument
-                if(ctx->argi+1 >= ctx->argc) {
-                    snprintf(
-                        ctx->err, CP_PARSE_ERR_LEN,
-                        "At argument near %d: Expected argument but got nothing.", ctx->argi
-                    );
-                    return false;
-                }
-                arg = ctx->argv[++ctx->argi];
-                double value;
-                if(sscanf(arg, "%lf", &value) != 1) {
-                    snprintf(
-                        ctx->err, CP_PARSE_ERR_LEN,
-                        "At argument near %d: Expected a number literal.", ctx->argi
-                    );
-                    return false;
-                }
-                *(double*)(opt.holder) = value;
-                return true;
-            }
-            char *assign;
-            if((assign = strchr(arg, '=')) == NULL) {
-                if((assign = strchr(arg, ':')) == NULL) {
-                    snprintf(
-                        ctx->err, CP_PARSE_ERR_LEN,
-                        "At argument near %d: Expected either '=', ':' or ' ' to set value. E.g. `flag=this flag:that`.", ctx->argi
-                    );
-                    return false;
-                }
-            }
-            ++assign;
-            double value;
-            if(sscanf(assign, "%lf", &value) != 1) {
-                snprintf(
-                    ctx->err, CP_PARSE_ERR_LEN,
-                    "At argument near %d: Expected a number literal.", ctx->argi
-                );
-                return false;
-            }
-            *(double*)(opt.holder) = value;
-            return true;
-        } break;
-        default: {
-            strncpy(ctx->err, "Internal: Unknown option kind.", CP_PARSE_ERR_LEN);
-            return false; // in theory, unreachable
-        } break;
+    return -1;
+}
+
+#ifdef CP_ENABLE_STATS
+// How many entries `cp__tableFind` compares `name` with.
+static uint64_t cp__tableProbes(const Cp__NameTable *table, const char *name, size_t len, uint32_t hash) {
+    uint64_t probes = 0;
+    for(uint32_t slot = hash & table->mask; table->slots[slot] != 0; slot = (slot+1) & table->mask) {
+        ++probes;
+        uint32_t entry = table->slots[slot] - 1;
+        if(table->lens[entry] == len && memcmp(table->names[entry], name, len) == 0) break;
     }
+    return probes;
+}
 
-    return true;
+static void cp__statToken(const Cp_Ctx *ctx, const char *arg, size_t len) {
+    ++ctx->stats->tokens;
+    ctx->stats->bytes += len != SIZE_MAX ? len : strlen(arg);
+    if(ctx->stats->on_token != NULL) {
+        ctx->stats->on_token(ctx, arg, ctx->stats->user_data);
+    }
 }
 
-// returns where it stopped parsing `ctx->argv`, 0-indexed, or -1 for parsing error
-int cp_parseUntil(Cp_Ctx *ctx, uintmax_t subcommandc, const char *subcommandv[]) {
-    for(; ctx->argi < ctx->argc; ++ctx->argi) {
-        const char *arg = ctx->argv[ctx->argi];
-        if(ctx->dashdash_halt && cp__streq(arg, "--")) {
-            if(ctx->argumentc+1 >= ctx->argumentcap) {
-                return ctx->argi;
-            }
-            for(; ctx->argi < ctx->argc && ctx->argumentc < ctx->argumentcap; ++ctx->argi) {
-                arg = ctx->argv[ctx->argi];
-                ctx->argumentv[ctx->argumentc++] = (char*)arg;
-            }
-            return ctx->argi;
-        } else {
-            for(size_t j = 0; j < subcommandc; ++j) {
-                if(cp__streq(subcommandv[j], arg)) {
-                    return ctx->argi;
-                }
-            }
-        }
+static uint64_t cp__nowNs(void) {
+    struct timespec now;
+#ifdef CLOCK_MONOTONIC
+    clock_gettime(CLOCK_MONOTONIC, &now);
+#else
+    timespec_get(&now, TIME_UTC);
+#endif
+    return (uint64_t)now.tv_sec * 1000000000u + (uint64_t)now.tv_nsec;
+}
+#endif
 
-        if(cp__strHasPrefix(arg, "--")) {
-            arg+=2;
-            if(strlen(arg) != 0) { 
-                bool match = false;
-                for(size_t j = 0; j < ctx->optc; ++j) {
-                    if(cp__strHasPrefix(arg, ctx->optv[j].name)) {
-                        int name_len = strlen(ctx->optv[j].name);
-                        if(arg[name_len]!=0 && arg[name_len]!=':' && arg[name_len]!='=') {
-                            snprintf(
-                                ctx->err, CP_PARSE_ERR_LEN,
-                                "At argument near %d: Unknown long argument: '%s'.", ctx->argi, arg
-                            );
-                            return -1;
-                        }
-                        match = true;
-                        if(!cp__parseLongOpt(ctx, ctx->optv[j])) {
-                            return -1;
-                        }
-                    }
-                    if(match) {
-                        break;
-                    }
-                }
-                if(!match) {
-                    snprintf(
-                        ctx->err, CP_PARSE_ERR_LEN,
-                        "At argument near %d: Unknown long argument: '%s'.", ctx->argi, arg
-                    );
-                    return -1;
-                }
-            }
-        } else if(arg[0] == '-') {
-            ++arg;
-            int arg_amount = 0;
-            bool match;
-            for(int j = 0; arg[j] != '\0'; ++j) {
-                match = false;
-                ++arg_amount;
-                for(size_t k = 0; k < ctx->optc; ++k) {
-                    if(arg[j] == ctx->optv[k].short_name) {
-                        match = true;
-                        if(!cp__parseShortOpt(ctx, ctx->optv[k], arg_amount)) {
-                            return -1;
-                        }
-                    }
-                    if(match) {
-                        break;
-                    }
-                }
-                if(!match) {
-                    snprintf(
-                        ctx->err, CP_PARSE_ERR_LEN,
-                        "At argument near %d: Unknown short argument in arg: '%s'.", ctx->argi, arg
-                    );
-                    return -1;
-                }
-                if(
-                    arg[arg_amount] == '=' ||
-                    arg[arg_amount] == ':'
-                ) {
-                    if(arg_amount > 1) {
-                        snprintf(
-                            ctx->err, CP_PARSE_ERR_LEN,
-                         "At argument near %d: Short opts can only have an argument if isolated.", ctx->argi
-                        );
-                        return -1;
-                    }
-                    break;
-                }
-            }
-        } else {
-            if(ctx->argumentc+1 < ctx->argumentcap) {
-                ctx->argumentv[ctx->argumentc++] = (char*)arg;
-            }
+size_t cp_schemaSize(uintmax_t optc) {
+    // long names, then environment variables
+    return sizeof(Cp_Schema)
+        + 2 * optc * sizeof(const char*)
+        + 2 * optc * sizeof(uint32_t)
+        + 2 * cp__tableSlotCount(optc) * sizeof(uint32_t);
+}
+
+static uintmax_t cp__choiceCount(const Cp_Opt *opt) {
+    uintmax_t count = 0;
+    if(opt->kind == OPTK_ENUM && opt->choices != NULL) {
+        while(opt->choices[count].name != NULL) {
+            ++count;
         }
     }
-
-    return ctx->argi;
+    return count;
 }
 
-int cp_parse(Cp_Ctx *ctx) {
-    return cp_parseUntil(ctx, 0, NULL);
+// Rounded up to a pointer, so the next table stays aligned.
+static size_t cp__choiceTableSize(uintmax_t count) {
+    if(count == 0) {
+        return 0;
+    }
+    size_t size = count * sizeof(const char*) + count * sizeof(uint32_t) + cp__tableSlotCount(count) * sizeof(uint32_t);
+    return (size + sizeof(void*) - 1) / sizeof(void*) * sizeof(void*);
 }
 
-#ifndef CLI_PARSER_CUSTOM_USAGE
+size_t cp_choicesSize(uintmax_t optc, const Cp_Opt optv[]) {
+    size_t size = 0;
+    bool any = false;
+    for(uintmax_t i = 0; i < optc; ++i) {
+        any = any || optv[i].kind == OPTK_ENUM;
+        size += cp__choiceTableSize(cp__choiceCount(&optv[i]));
+    }
+    return any ? optc * sizeof(Cp__NameTable) + size : 0;
+}
 
-void cp_usage(Cp_Ctx *ctx, FILE *file) {
-    int maxlen = 0;
-    for (int i = 0; i < ctx->optc; ++i) {
-        int len = strlen(ctx->optv[i].name);
-        if (ctx->optv[i].short_name != '\0') {
-            len += 2; // for ", X"
+// One table per option in `storage`, followed by what the tables of `OPTK_ENUM` options point to.
+static bool cp__choicesBuild(Cp_Schema *schema, void *storage, size_t size) {
+    memset(storage, 0, size);
+    Cp__NameTable *tables = (Cp__NameTable*)storage;
+    char *at = (char*)(tables + schema->optc);
+    for(uintmax_t i = 0; i < schema->optc; ++i) {
+        const Cp_Opt *opt = &schema->optv[i];
+        uintmax_t count = cp__choiceCount(opt);
+        if(count == 0) {
+            continue;
         }
-        if (len > maxlen) maxlen = len;
+        Cp__NameTable *table = &tables[i];
+        uint32_t slotc = cp__tableSlotCount(count);
+        table->names = (const char**)at;
+        table->lens = (uint32_t*)(table->names + count);
+        table->slots = table->lens + count;
+        table->mask = slotc-1;
+        table->count = (uint32_t)count;
+        for(uintmax_t j = 0; j < count; ++j) {
+            table->names[j] = opt->choices[j].name;
+            table->lens[j] = (uint32_t)strlen(opt->choices[j].name);
+        }
+        if(!cp__tableBuild(table)) {
+            return false;
+        }
+        at += cp__choiceTableSize(count);
+    }
+    schema->choices = tables;
+    return true;
+}
+
+Cp_Schema *cp_compileOptsInto(void *storage, size_t size, uintmax_t optc, Cp_Opt optv[]) {
+    if(storage == NULL || optc == 0 || optv == NULL || optc > INT_MAX/4 || size < cp_schemaSize(optc)) {
+        return NULL;
     }
+    uint32_t slotc = cp__tableSlotCount(optc);
+    Cp_Schema *schema = (Cp_Schema*)storage;
+    memset(schema, 0, cp_schemaSize(optc));
+    schema->optc = optc;
+    schema->optv = optv;
 
-    printf("OPTIONS:\n");
-    for(int i = 0; i < ctx->optc; ++i) {
-        Cp_Opt opt = ctx->optv[i];
-        printf("  %s", opt.name);
-        if(opt.short_name != '\0') {
-            printf(", %c", opt.short_name);
+    // the tables live in the same block as the schema itself, pointers first so they stay aligned
+    schema->longs.names = (const char**)(schema+1);
+    schema->envs.names = schema->longs.names + optc;
+    schema->longs.lens = (uint32_t*)(schema->envs.names + optc);
+    schema->envs.lens = schema->longs.lens + optc;
+    schema->longs.slots = schema->envs.lens + optc;
+    schema->envs.slots = schema->longs.slots + slotc;
+    schema->longs.mask = slotc-1;
+    schema->longs.count = (uint32_t)optc;
+    for(uintmax_t i = 0; i < optc; ++i) {
+        schema->longs.names[i] = optv[i].name;
+        schema->longs.lens[i] = optv[i].name != NULL ? (uint32_t)strlen(optv[i].name) : 0;
+    }
+    if(!cp__tableBuild(&schema->longs)) {
+        return NULL;
+    }
+    schema->envs.mask = slotc-1;
+    schema->envs.count = (uint32_t)optc;
+    for(uintmax_t i = 0; i < optc; ++i) {
+        schema->envs.names[i] = optv[i].env;
+        schema->envs.lens[i] = optv[i].env != NULL ? (uint32_t)strlen(optv[i].env) : 0;
+    }
+    if(!cp__tableBuild(&schema->envs)) {
+        return NULL;
+    }
+    for(uintmax_t i = 0; i < optc; ++i) {
+        unsigned char short_name = (unsigned char)optv[i].short_name;
+        if(short_name == '\0') {
+            continue;
+        }
+        if(schema->shorts[short_name] != 0) {
+            return NULL;
+        }
+        schema->shorts[short_name] = (uint32_t)i+1;
+    }
+    size_t choices_size = cp_choicesSize(optc, optv);
+    if(choices_size > 0 && size - cp_schemaSize(optc) >= choices_size) {
+        if(!cp__choicesBuild(schema, (char*)storage + cp_schemaSize(optc), choices_size)) {
+            return NULL;
         }
-        int printed_len = (opt.short_name != '\0')
-            ? (int)strlen(opt.name) + 3  // "name, x"
-            : (int)strlen(opt.name);
-        int padding = maxlen - printed_len + 2;
-        printf("%-*s", padding, "\0");
-        printf(" : %s\n", opt.short_desc);
     }
+
+    return schema;
+}
+
+#ifndef CP_NO_MALLOC
+Cp_Schema *cp_compileOpts(uintmax_t optc, Cp_Opt optv[]) {
+    if(optc == 0 || optv == NULL || optc > INT_MAX/4) {
+        return NULL;
+    }
+    size_t size = cp_schemaSize(optc) + cp_choicesSize(optc, optv);
+    void *storage = CP_CALLOC(1, size);
+    if(storage == NULL) {
+        return NULL;
+    }
+    Cp_Schema *schema = cp_compileOptsInto(storage, size, optc, optv);
+    if(schema == NULL) {
+        CP_FREE(storage);
+    }
+    return schema;
+}
+void cp_freeSchema(Cp_Schema *schema) {
+    CP_FREE(schema);
+}
+#endif
+
+int cp__findLongOpt(const Cp_Ctx *ctx, const char *name, size_t len, uint32_t hash) {
+    if(ctx->schema != NULL) {
+        CP__STAT(ctx, comparisons, cp__tableProbes(&ctx->schema->longs, name, len, hash));
+        return cp__tableFind(&ctx->schema->longs, name, len, hash);
+    }
+    for(size_t i = 0; i < ctx->optc; ++i) {
+        const char *opt_name = ctx->optv[i].name;
+        CP__STAT(ctx, comparisons, 1);
+        if(opt_name != NULL && strncmp(opt_name, name, len) == 0 && opt_name[len] == '\0') {
+            return (int)i;
+        }
+    }
+    return -1;
+}
+
+size_t cp_subcommandsSize(uintmax_t subcommandc) {
+    return sizeof(Cp_SubcmdSet)
+        + subcommandc * sizeof(const char*)
+        + subcommandc * sizeof(uint32_t)
+        + cp__tableSlotCount(subcommandc) * sizeof(uint32_t);
+}
+
+Cp_SubcmdSet *cp_compileSubcommandsInto(void *storage, size_t size, uintmax_t subcommandc, const char *subcommandv[]) {
+    if(storage == NULL || subcommandc == 0 || subcommandv == NULL || subcommandc > INT_MAX/4 || size < cp_subcommandsSize(subcommandc)) {
+        return NULL;
+    }
+    uint32_t slotc = cp__tableSlotCount(subcommandc);
+    Cp_SubcmdSet *set = (Cp_SubcmdSet*)storage;
+    memset(set, 0, cp_subcommandsSize(subcommandc));
+    set->names.names = (const char**)(set+1);
+    set->names.lens = (uint32_t*)(set->names.names + subcommandc);
+    set->names.slots = set->names.lens + subcommandc;
+    set->names.mask = slotc-1;
+    set->names.count = (uint32_t)subcommandc;
+    for(uintmax_t i = 0; i < subcommandc; ++i) {
+        set->names.names[i] = subcommandv[i];
+        set->names.lens[i] = subcommandv[i] != NULL ? (uint32_t)strlen(subcommandv[i]) : 0;
+    }
+    if(!cp__tableBuild(&set->names)) {
+        return NULL;
+    }
+
+    return set;
+}
+
+#ifndef CP_NO_MALLOC
+Cp_SubcmdSet *cp_compileSubcommands(uintmax_t subcommandc, const char *subcommandv[]) {
+    if(subcommandc == 0 || subcommandv == NULL || subcommandc > INT_MAX/4) {
+        return NULL;
+    }
+    size_t size = cp_subcommandsSize(subcommandc);
+    void *storage = CP_CALLOC(1, size);
+    if(storage == NULL) {
+        return NULL;
+    }
+    Cp_SubcmdSet *set = cp_compileSubcommandsInto(storage, size, subcommandc, subcommandv);
+    if(set == NULL) {
+        CP_FREE(storage);
+    }
+    return set;
+}
+void cp_freeSubcommands(Cp_SubcmdSet *set) {
+    CP_FREE(set);
+}
+#endif
+int cp_findSubcommand(const Cp_SubcmdSet *set, const char *name) {
+    size_t len;
+    uint32_t hash = cp__hashStr(name, &len);
+    return cp__tableFind(&set->names, name, len, hash);
+}
+
+int cp__findShortOpt(const Cp_Ctx *ctx, char short_name) {
+    if(ctx->schema != NULL) {
+        return (int)ctx->schema->shorts[(unsigned char)short_name] - 1;
+    }
+    for(size_t i = 0; i < ctx->optc; ++i) {
+        CP__STAT(ctx, comparisons, 1);
+        if(ctx->optv[i].short_name == short_name) {
+            return (int)i;
+        }
+    }
+    return -1;
+}
+
+// No error yet, which doesn't involve any option.
+static void cp__clearError(Cp_Error *err) {
+    memset(err, 0, sizeof(*err));
+    err->opt = -1;
+    err->other = -1;
+}
+
+bool cp_initCtx(Cp_Ctx *ctx, int argc, char *argv[], uintmax_t optc, Cp_Opt optv[], int argumentcap, char *argumentv[]) {
+    if(
+        ctx == NULL ||
+        optc == 0 ||
+        optv == NULL ||
+        argc < 0 ||
+        (argc > 0 && argv == NULL)
+    ) {
+        return false;
+    }
+    memset(ctx, 0, sizeof(*ctx));
+    cp__clearError(&ctx->err);
+
+    ctx->argc = argc;
+    ctx->argv = argv;
+
+    ctx->optc = optc;
+    ctx->optv = optv;
+
+    ctx->argumentcap = argumentcap;
+    ctx->argumentv = argumentv;
+
+    return true;
+}
+#ifndef CP_NO_MALLOC
+static void cp__releaseFiles(Cp_Ctx *ctx);
+#endif
+void cp_resetCtx(Cp_Ctx *ctx, int argc, char *argv[]) {
+#ifndef CP_NO_MALLOC
+    cp__releaseFiles(ctx);
+#endif
+    ctx->argc = argc;
+    ctx->argv = argv;
+    ctx->argi = 0;
+    ctx->arg = NULL;
+    ctx->pending = 0;
+    ctx->halted = false;
+    ctx->argumentc = 0;
+    cp__clearError(&ctx->err);
+    memset(ctx->seen_inline, 0, sizeof(ctx->seen_inline));
+    if(ctx->seen != NULL) {
+        memset(ctx->seen, 0, (ctx->seen_words > 0 ? ctx->seen_words : CP_OPTION_WORDS(ctx->optc)) * sizeof(uint64_t));
+    }
+    if(ctx->counts != NULL) {
+        memset(ctx->counts, 0, ctx->optc * sizeof(uint32_t));
+    }
+}
+
+#ifndef CP_NO_MALLOC
+Cp_Ctx *cp_newCtx(int argc, char *argv[], uintmax_t optc, Cp_Opt optv[], int argumentcap, char *argumentv[]) {
+    // big option tables get their seen bits right after the context, in the same allocation
+    size_t extra = optc > CP_SEEN_INLINE ? CP_OPTION_WORDS(optc) * sizeof(uint64_t) : 0;
+    Cp_Ctx *ctx = (Cp_Ctx*)CP_CALLOC(1, sizeof(Cp_Ctx) + extra);
+    if(ctx == NULL) {
+        return NULL;
+    }
+    if(!cp_initCtx(ctx, argc, argv, optc, optv, argumentcap, argumentv)) {
+        CP_FREE(ctx);
+        return NULL;
+    }
+    if(extra > 0) {
+        ctx->seen = (uint64_t*)(ctx+1);
+        ctx->seen_words = CP_OPTION_WORDS(optc);
+    }
+    return ctx;
+}
+void cp_freeCtx(Cp_Ctx *ctx) {
+    if(ctx == NULL) return;
+    cp_releaseCtx(ctx);
+    CP_FREE(ctx);
+}
+#endif
+
+static inline bool cp__isSpace(char c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == '\v' || c == '\f';
+}
+
+// A response or config file, kept for as long as the context since values point right into it.
+struct Cp__File {
+    struct Cp__File *next;
+    char *data;
+    size_t len;
+    bool mapped;
+    char *tail; // copy of the last string if it ends exactly at the end of a mapped page
+};
+
+// NUL-terminates `[str, end)`, where `end` may be the end of `file`. NULL when out of memory.
+static char *cp__terminate(struct Cp__File *file, char *str, char *end) {
+#ifdef CP__HAS_MMAP
+    // past the end of the file the last page reads as zeroes, unless the file fills it up completely
+    if(file != NULL && file->mapped && end == file->data + file->len && file->len % (size_t)sysconf(_SC_PAGESIZE) == 0) {
+        file->tail = (char*)CP_CALLOC((size_t)(end - str) + 1, 1);
+        if(file->tail == NULL) return NULL;
+        memcpy(file->tail, str, (size_t)(end - str));
+        return file->tail;
+    }
+#else
+    (void)file;
+#endif
+    *end = '\0'; // buffers read without mmap have one byte to spare
+    return str;
+}
+
+#ifndef CP_NO_MALLOC
+typedef struct {
+    char **argv;
+    int argc;
+    int cap;
+    int files;
+} Cp__ArgList;
+
+static bool cp__argPush(Cp__ArgList *list, char *arg) {
+    if(list->argc == list->cap) {
+        if(list->cap > INT_MAX/2) return false;
+        int cap = list->cap ? list->cap * 2 : 32;
+        char **argv = (char**)CP_REALLOC(list->argv, cap * sizeof(char*));
+        if(argv == NULL) return false;
+        list->argv = argv;
+        list->cap = cap;
+    }
+    list->argv[list->argc++] = arg;
+    return true;
+}
+
+// Returns false only when out of memory. `*out` is NULL when `path` can't be read.
+static bool cp__loadFile(const char *path, struct Cp__File **out) {
+    *out = NULL;
+#ifdef CP__HAS_MMAP
+    int fd = open(path, O_RDONLY);
+    if(fd < 0) return true;
+    struct stat st;
+    if(fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+        close(fd);
+        return true;
+    }
+    struct Cp__File *file = (struct Cp__File*)CP_CALLOC(1, sizeof(*file));
+    if(file == NULL) {
+        close(fd);
+        return false;
+    }
+    file->len = (size_t)st.st_size;
+    if(file->len > 0) {
+        // private and writable, so arguments are unquoted and terminated inside of the mapping without touching the file
+        void *data = mmap(NULL, file->len, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+        if(data == MAP_FAILED) {
+            close(fd);
+            CP_FREE(file);
+            return true;
+        }
+        file->data = (char*)data;
+        file->mapped = true;
+    }
+    close(fd);
+#else
+    FILE *f = fopen(path, "rb");
+    if(f == NULL) return true;
+    long len = -1;
+    if(fseek(f, 0, SEEK_END) == 0) len = ftell(f);
+    if(len < 0 || fseek(f, 0, SEEK_SET) != 0) {
+        fclose(f);
+        return true;
+    }
+    struct Cp__File *file = CP_CALLOC(1, sizeof(*file));
+    char *data = CP_CALLOC((size_t)len + 1, 1);
+    if(file == NULL || data == NULL) {
+        fclose(f);
+        CP_FREE(file);
+        CP_FREE(data);
+        return false;
+    }
+    file->len = fread(data, 1, (size_t)len, f);
+    file->data = data;
+    fclose(f);
+#endif
+    *out = file;
+    return true;
+}
+
+static Cp_Err_Code cp__expandArg(Cp_Ctx *ctx, Cp__ArgList *list, char *arg, int depth);
+
+// Splits `file` into arguments in place, with GCC's rules: whitespace separates arguments,
+// single and double quotes group them and a backslash escapes the next character, even inside of quotes.
+static Cp_Err_Code cp__expandFile(Cp_Ctx *ctx, Cp__ArgList *list, struct Cp__File *file, int depth) {
+    char *at = file->data;
+    char *end = at + file->len;
+    while(at < end) {
+        while(at < end && cp__isSpace(*at)) ++at;
+        if(at == end) break;
+
+        char *arg = at;
+        char *out = at;
+        bool squote = false, dquote = false, bsquote = false;
+        for(; at < end; ++at) {
+            char c = *at;
+            if(bsquote) {
+                bsquote = false;
+                *out++ = c;
+            } else if(c == '\\') {
+                bsquote = true;
+            } else if(squote) {
+                if(c == '\'') squote = false;
+                else *out++ = c;
+            } else if(dquote) {
+                if(c == '"') dquote = false;
+                else *out++ = c;
+            } else if(cp__isSpace(c)) {
+                break;
+            } else if(c == '\'') {
+                squote = true;
+            } else if(c == '"') {
+                dquote = true;
+            } else {
+                *out++ = c;
+            }
+        }
+
+        arg = cp__terminate(file, arg, out);
+        if(arg == NULL) return CP_ERR_OUT_OF_MEMORY;
+        if(at < end) ++at;
+
+        Cp_Err_Code code = cp__expandArg(ctx, list, arg, depth);
+        if(code != CP_ERR_NONE) return code;
+    }
+    return CP_ERR_NONE;
+}
+
+static Cp_Err_Code cp__expandArg(Cp_Ctx *ctx, Cp__ArgList *list, char *arg, int depth) {
+    if(arg[0] != '@' || arg[1] == '\0') {
+        return cp__argPush(list, arg) ? CP_ERR_NONE : CP_ERR_OUT_OF_MEMORY;
+    }
+    if(depth >= CP_RESPONSE_FILE_DEPTH) return CP_ERR_RESPONSE_FILE_DEPTH;
+    if(list->files >= CP_RESPONSE_FILE_MAX) return CP_ERR_RESPONSE_FILE_COUNT;
+
+    struct Cp__File *file;
+    if(!cp__loadFile(arg + 1, &file)) return CP_ERR_OUT_OF_MEMORY;
+    if(file == NULL) {
+        // like GCC, an argument naming a file that can't be read is kept as it is
+        return cp__argPush(list, arg) ? CP_ERR_NONE : CP_ERR_OUT_OF_MEMORY;
+    }
+    file->next = ctx->files;
+    ctx->files = file;
+    ++list->files;
+    return cp__expandFile(ctx, list, file, depth + 1);
+}
+
+// Replaces `ctx->argv` by a copy with every response file from `ctx->argi` on expanded.
+// Only allocates when there is an argument starting with '@'.
+static bool cp__expandResponseFiles(Cp_Ctx *ctx) {
+    if(ctx->resp_argv != NULL && ctx->argv == ctx->resp_argv) {
+        return true;
+    }
+    // `argv[0]` is the program or subcommand name, never a response file
+    int first = ctx->argi > 0 ? ctx->argi : 1;
+    while(first < ctx->argc && ctx->argv[first][0] != '@') ++first;
+    if(first >= ctx->argc) {
+        return true;
+    }
+
+    Cp__ArgList list = {0};
+    for(int i = 0; i < ctx->argc; ++i) {
+        Cp_Err_Code code = i < first
+            ? (cp__argPush(&list, ctx->argv[i]) ? CP_ERR_NONE : CP_ERR_OUT_OF_MEMORY)
+            : cp__expandArg(ctx, &list, ctx->argv[i], 0);
+        if(code != CP_ERR_NONE) {
+            CP_FREE(list.argv);
+            ctx->argi = i;
+            ctx->arg = ctx->argv[i];
+            return cp__fail(ctx, code, NULL, 0);
+        }
+    }
+    if(ctx->argument_bits != NULL) {
+        // the caller sized theirs for the argv before expansion, they get them back once the context is released
+        if(ctx->argument_bits != ctx->resp_bits) {
+            ctx->user_bits = ctx->argument_bits;
+        }
+        uint64_t *bits = (uint64_t*)CP_CALLOC(CP_ARGUMENT_WORDS(list.argc), sizeof(uint64_t));
+        if(bits == NULL) {
+            CP_FREE(list.argv);
+            ctx->arg = NULL;
+            return cp__fail(ctx, CP_ERR_OUT_OF_MEMORY, NULL, 0);
+        }
+        size_t kept = CP_ARGUMENT_WORDS(ctx->argi);
+        if(kept > 0) memcpy(bits, ctx->argument_bits, kept * sizeof(uint64_t));
+        CP_FREE(ctx->resp_bits);
+        ctx->resp_bits = bits;
+        ctx->argument_bits = bits;
+    }
+    CP_FREE(ctx->resp_argv);
+    ctx->resp_argv = list.argv;
+    ctx->argv = list.argv;
+    ctx->argc = list.argc;
+    return true;
+}
+
+// Response and config files, along with what expanding the former allocated.
+static void cp__releaseFiles(Cp_Ctx *ctx) {
+    struct Cp__File *file = ctx->files;
+    while(file != NULL) {
+        struct Cp__File *next = file->next;
+#ifdef CP__HAS_MMAP
+        if(file->mapped) munmap(file->data, file->len);
+#else
+        CP_FREE(file->data);
+#endif
+        CP_FREE(file->tail);
+        CP_FREE(file);
+        file = next;
+    }
+    if(ctx->resp_bits != NULL && ctx->argument_bits == ctx->resp_bits) {
+        ctx->argument_bits = ctx->user_bits;
+    }
+    CP_FREE(ctx->resp_argv);
+    CP_FREE(ctx->resp_bits);
+    ctx->files = NULL;
+    ctx->resp_argv = NULL;
+    ctx->resp_bits = NULL;
+    ctx->user_bits = NULL;
+}
+
+void cp_releaseCtx(Cp_Ctx *ctx) {
+    if(ctx == NULL) return;
+    cp__releaseFiles(ctx);
+    if(ctx->seen_owned != NULL && ctx->seen == ctx->seen_owned) {
+        ctx->seen = NULL;
+        ctx->seen_words = 0;
+    }
+    CP_FREE(ctx->seen_owned);
+    ctx->seen_owned = NULL;
+}
+#endif
+
+// Number parsers. They never allocate, ignore the locale and fail unless all `len` bytes are part of the number.
+// Integers take an optional sign and a `0x`/`0X` (hex) or `0b`/`0B` (binary) prefix.
+static int cp__digitValue(char c) {
+    if(c >= '0' && c <= '9') return c - '0';
+    if(c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if(c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return 99;
+}
+
+// parses the digits after any sign, `str` may still hold a base prefix
+static Cp__Num_Status cp__parseMagnitude(const char *str, size_t len, uint64_t *out) {
+    unsigned base = 10;
+    if(len > 2 && str[0] == '0' && (str[1] == 'x' || str[1] == 'X')) {
+        base = 16;
+        str += 2; len -= 2;
+    } else if(len > 2 && str[0] == '0' && (str[1] == 'b' || str[1] == 'B')) {
+        base = 2;
+        str += 2; len -= 2;
+    }
+    if(len == 0) {
+        return CP__NUM_INVALID;
+    }
+
+    uint64_t value = 0;
+    bool overflow = false;
+    for(size_t i = 0; i < len; ++i) {
+        unsigned digit = (unsigned)cp__digitValue(str[i]);
+        if(digit >= base) {
+            return CP__NUM_INVALID;
+        }
+        if(value > (UINT64_MAX - digit) / base) {
+            // keep going, a later non digit still makes it invalid rather than out of range
+            overflow = true;
+        }
+        value = value*base + digit;
+    }
+    if(overflow) {
+        return CP__NUM_RANGE;
+    }
+    *out = value;
+    return CP__NUM_OK;
+}
+
+Cp__Num_Status cp__parseUint64(const char *str, size_t len, uint64_t *out) {
+    if(len > 0 && str[0] == '+') {
+        ++str; --len;
+    }
+    return cp__parseMagnitude(str, len, out);
+}
+
+Cp__Num_Status cp__parseInt64(const char *str, size_t len, int64_t *out) {
+    bool negative = false;
+    if(len > 0 && (str[0] == '+' || str[0] == '-')) {
+        negative = str[0] == '-';
+        ++str; --len;
+    }
+    uint64_t magnitude;
+    Cp__Num_Status status = cp__parseMagnitude(str, len, &magnitude);
+    if(status != CP__NUM_OK) {
+        return status;
+    }
+    if(negative) {
+        if(magnitude > (uint64_t)INT64_MAX + 1) {
+            return CP__NUM_RANGE;
+        }
+        *out = magnitude == (uint64_t)INT64_MAX + 1 ? INT64_MIN : -(int64_t)magnitude;
+    } else {
+        if(magnitude > (uint64_t)INT64_MAX) {
+            return CP__NUM_RANGE;
+        }
+        *out = (int64_t)magnitude;
+    }
+    return CP__NUM_OK;
+}
+
+static bool cp__strEqNoCase(const char *str, size_t len, const char *lower) {
+    size_t i = 0;
+    for(; i < len && lower[i] != '\0'; ++i) {
+        char c = str[i];
+        if(c >= 'A' && c <= 'Z') c += 'a' - 'A';
+        if(c != lower[i]) return false;
+    }
+    return i == len && lower[i] == '\0';
+}
+
+// Significant digits handed to strtod, enough to round any double correctly once the rest is
+// folded into a trailing sticky digit.
+#define CP__DOUBLE_DIGITS 768
+
+// Hexadecimal floats like `0x1.8p3`, left to strtod with the '.' swapped for the locale's decimal point.
+static Cp__Num_Status cp__parseHexDouble(const char *str, size_t len, double *out) {
+    char buf[CP__DOUBLE_DIGITS + 32];
+    if(len >= sizeof(buf)) {
+        return CP__NUM_INVALID;
+    }
+    char point = localeconv()->decimal_point[0];
+    for(size_t i = 0; i < len; ++i) {
+        buf[i] = str[i] == '.' ? point : str[i];
+    }
+    buf[len] = '\0';
+    char *end;
+    errno = 0;
+    double value = strtod(buf, &end);
+    if(end != buf + len) {
+        return CP__NUM_INVALID;
+    }
+    if(errno == ERANGE && (value == HUGE_VAL || value == -HUGE_VAL)) {
+        return CP__NUM_RANGE;
+    }
+    *out = value;
+    return CP__NUM_OK;
+}
+
+// Decimal literals with an optional fraction and exponent, hexadecimal floats, `inf` and `infinity`.
+// `nan` is rejected since it is the CP_NUMBER_INVALID sentinel.
+// Mantissas of up to 19 digits with a power of ten up to 22 are converted exactly by hand, everything
+// else is rebuilt as plain digits and an exponent for strtod, so every result is correctly rounded.
+Cp__Num_Status cp__parseDouble(const char *str, size_t len, double *out) {
+    bool negative = false;
+    if(len > 0 && (str[0] == '+' || str[0] == '-')) {
+        negative = str[0] == '-';
+        ++str; --len;
+    }
+    if(cp__strEqNoCase(str, len, "inf") || cp__strEqNoCase(str, len, "infinity")) {
+        *out = negative ? -HUGE_VAL : HUGE_VAL;
+        return CP__NUM_OK;
+    }
+    if(len > 2 && str[0] == '0' && (str[1] == 'x' || str[1] == 'X')) {
+        Cp__Num_Status status = cp__parseHexDouble(str, len, out);
+        if(status == CP__NUM_OK && negative) {
+            *out = -*out;
+        }
+        return status;
+    }
+
+    uint64_t mantissa = 0;
+    int digits = 0; // significant digits stored in `mantissa`
+    int exp10 = 0;
+    bool any_digit = false;
+    size_t i = 0;
+    for(; i < len && str[i] >= '0' && str[i] <= '9'; ++i) {
+        any_digit = true;
+        if(digits < 19) {
+            mantissa = mantissa*10 + (uint64_t)(str[i] - '0');
+            if(mantissa != 0) ++digits;
+        } else {
+            ++exp10; // dropped digit
+        }
+    }
+    if(i < len && str[i] == '.') {
+        for(++i; i < len && str[i] >= '0' && str[i] <= '9'; ++i) {
+            any_digit = true;
+            if(digits < 19) {
+                mantissa = mantissa*10 + (uint64_t)(str[i] - '0');
+                if(mantissa != 0) ++digits;
+                --exp10;
+            }
+        }
+    }
+    if(!any_digit) {
+        return CP__NUM_INVALID;
+    }
+    size_t digits_end = i;
+    int exponent = 0;
+    if(i < len && (str[i] == 'e' || str[i] == 'E')) {
+        ++i;
+        bool exp_negative = false;
+        if(i < len && (str[i] == '+' || str[i] == '-')) {
+            exp_negative = str[i] == '-';
+            ++i;
+        }
+        if(i == len) {
+            return CP__NUM_INVALID;
+        }
+        for(; i < len && str[i] >= '0' && str[i] <= '9'; ++i) {
+            if(exponent < 100000) {
+                exponent = exponent*10 + (str[i] - '0');
+            }
+        }
+        if(exp_negative) exponent = -exponent;
+        exp10 += exponent;
+    }
+    if(i != len) {
+        return CP__NUM_INVALID;
+    }
+
+    double value;
+    if(mantissa == 0 || exp10 < -360) {
+        value = 0.0;
+    } else if(exp10 > 310) {
+        return CP__NUM_RANGE;
+    } else if(mantissa <= (1ull << 53) && exp10 >= -22 && exp10 <= 22) {
+        // both operands are exact, so the single rounding makes the result exact too
+        static const double exact[] = {
+            1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+            1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+        };
+        value = exp10 < 0
+            ? (double)mantissa / exact[-exp10]
+            : (double)mantissa * exact[exp10];
+    } else {
+        // the digits without leading zeros or the point, so the locale doesn't matter
+        char buf[CP__DOUBLE_DIGITS + 32];
+        size_t n = 0;
+        long shift = exponent;
+        bool sticky = false;
+        bool fraction = false;
+        for(size_t j = 0; j < digits_end; ++j) {
+            if(str[j] == '.') {
+                fraction = true;
+            } else if(n == 0 && str[j] == '0') {
+                if(fraction) --shift;
+            } else if(n < CP__DOUBLE_DIGITS) {
+                buf[n++] = str[j];
+                if(fraction) --shift;
+            } else {
+                sticky |= str[j] != '0';
+                if(!fraction) ++shift;
+            }
+        }
+        if(sticky) {
+            buf[n++] = '1';
+            --shift;
+        }
+        snprintf(buf + n, sizeof(buf) - n, "e%ld", shift);
+        errno = 0;
+        value = strtod(buf, NULL);
+        if(errno == ERANGE && value == HUGE_VAL) {
+            return CP__NUM_RANGE;
+        }
+    }
+    *out = negative ? -value : value;
+    return CP__NUM_OK;
+}
+
+// Where the value of `opt` goes.
+void *cp__holder(const Cp_Ctx *ctx, const Cp_Opt *opt) {
+    if(ctx->valuev != NULL) {
+        return &ctx->valuev[opt - ctx->optv];
+    }
+    if(ctx->record != NULL) {
+        return (char*)ctx->record + (uintptr_t)opt->holder;
+    }
+    return opt->holder;
+}
+
+static uint64_t *cp__seenWords(const Cp_Ctx *ctx) {
+    if(ctx->seen != NULL) {
+        return ctx->seen;
+    }
+    return ctx->optc <= CP_SEEN_INLINE ? (uint64_t*)ctx->seen_inline : NULL;
+}
+
+void cp__markSeen(Cp_Ctx *ctx, const Cp_Opt *opt) {
+    CP__STAT_HIT(ctx, opt);
+    uint64_t *words = cp__seenWords(ctx);
+    size_t i = (size_t)(opt - ctx->optv);
+    if(words != NULL) {
+        words[i / 64] |= (uint64_t)1 << (i % 64);
+    }
+    if(ctx->counts != NULL) {
+        ++ctx->counts[i];
+    }
+}
+
+bool cp_seen(const Cp_Ctx *ctx, int opt) {
+    const uint64_t *words = cp__seenWords(ctx);
+    if(words == NULL || opt < 0 || (uintmax_t)opt >= ctx->optc) {
+        return false;
+    }
+    return (words[opt / 64] >> (opt % 64)) & 1;
+}
+
+size_t cp_rulesSize(uintmax_t optc, uintmax_t rulec) {
+    return sizeof(Cp_Rules) + (rulec + 1) * CP_OPTION_WORDS(optc) * sizeof(uint64_t) + rulec * 2 * sizeof(uint32_t);
+}
+
+Cp_Rules *cp_compileRulesInto(void *storage, size_t size, uintmax_t optc, uintmax_t rulec, const Cp_Rule rulev[]) {
+    if(storage == NULL || optc == 0 || (rulec > 0 && rulev == NULL) || size < cp_rulesSize(optc, rulec)) {
+        return NULL;
+    }
+    Cp_Rules *rules = (Cp_Rules*)storage;
+    memset(rules, 0, cp_rulesSize(optc, rulec));
+    rules->optc = optc;
+    rules->rulec = rulec;
+    rules->rulev = rulev;
+    rules->words = CP_OPTION_WORDS(optc);
+    rules->required = (uint64_t*)(rules+1);
+    rules->masks = rules->required + rules->words;
+    rules->spans = (uint32_t*)(rules->masks + rulec * rules->words);
+    for(uintmax_t r = 0; r < rulec; ++r) {
+        const Cp_Rule *rule = &rulev[r];
+        if(rule->optc > 0 && rule->optv == NULL) {
+            return NULL;
+        }
+        if(rule->kind == CP_RULE_REQUIRES && rule->optc < 2) {
+            return NULL;
+        }
+        uint64_t *mask = rule->kind == CP_RULE_REQUIRED ? rules->required : rules->masks + r * rules->words;
+        for(uintmax_t j = rule->kind == CP_RULE_REQUIRES ? 1 : 0; j < rule->optc; ++j) {
+            int i = rule->optv[j];
+            if(i < 0 || (uintmax_t)i >= optc) {
+                return NULL;
+            }
+            mask[i / 64] |= (uint64_t)1 << (i % 64);
+        }
+        uint32_t first = 0;
+        uint32_t last = 0;
+        if(rule->kind != CP_RULE_REQUIRED) {
+            for(uint32_t w = 0; w < rules->words; ++w) {
+                if(mask[w] == 0) continue;
+                if(last == 0) first = w;
+                last = w + 1;
+            }
+        }
+        rules->spans[2*r] = first;
+        rules->spans[2*r + 1] = last;
+    }
+    return rules;
+}
+
+#ifndef CP_NO_MALLOC
+Cp_Rules *cp_compileRules(uintmax_t optc, uintmax_t rulec, const Cp_Rule rulev[]) {
+    size_t size = cp_rulesSize(optc, rulec);
+    void *storage = CP_CALLOC(1, size);
+    if(storage == NULL) {
+        return NULL;
+    }
+    Cp_Rules *rules = cp_compileRulesInto(storage, size, optc, rulec, rulev);
+    if(rules == NULL) {
+        CP_FREE(storage);
+    }
+    return rules;
+}
+void cp_freeRules(Cp_Rules *rules) {
+    CP_FREE(rules);
+}
+#endif
+
+// Lowest option set in both `a` and `b` within words `from` to `to`, or -1.
+static int cp__firstCommon(const uint64_t *a, const uint64_t *b, size_t from, size_t to, bool negate_b) {
+    for(size_t w = from; w < to; ++w) {
+        uint64_t bits = a[w] & (negate_b ? ~b[w] : b[w]);
+        if(bits != 0) {
+            return (int)(w * 64 + (size_t)cp__ctz64(bits));
+        }
+    }
+    return -1;
+}
+
+static bool cp__failRule(Cp_Ctx *ctx, Cp_Err_Code code, int opt, int other) {
+    cp__fail(ctx, code, &ctx->optv[opt], 0);
+    ctx->err.arg = NULL;
+    ctx->err.other = other;
+    return false;
+}
+
+bool cp_checkRules(Cp_Ctx *ctx, const Cp_Rules *rules) {
+    const uint64_t *seen = cp__seenWords(ctx);
+    if(rules == NULL || seen == NULL) {
+        return true;
+    }
+    size_t words = rules->words;
+    int missing = cp__firstCommon(rules->required, seen, 0, words, true);
+    if(missing >= 0) {
+        return cp__failRule(ctx, CP_ERR_MISSING_OPTION, missing, -1);
+    }
+    for(uintmax_t r = 0; r < rules->rulec; ++r) {
+        const Cp_Rule *rule = &rules->rulev[r];
+        const uint64_t *mask = rules->masks + r * words;
+        uint32_t from = rules->spans[2*r];
+        uint32_t to = rules->spans[2*r + 1];
+        switch(rule->kind) {
+            case CP_RULE_EXCLUSIVE: {
+                int first = -1;
+                for(size_t w = from; w < to; ++w) {
+                    uint64_t bits = seen[w] & mask[w];
+                    while(bits != 0) {
+                        int i = (int)(w * 64 + (size_t)cp__ctz64(bits));
+                        if(first >= 0) {
+                            return cp__failRule(ctx, CP_ERR_EXCLUSIVE_OPTIONS, i, first);
+                        }
+                        first = i;
+                        bits &= bits - 1;
+                    }
+                }
+            } break;
+            case CP_RULE_REQUIRES: {
+                int trigger = rule->optv[0];
+                if(!((seen[trigger / 64] >> (trigger % 64)) & 1)) {
+                    break;
+                }
+                missing = cp__firstCommon(mask, seen, from, to, true);
+                if(missing >= 0) {
+                    return cp__failRule(ctx, CP_ERR_REQUIRED_BY, missing, trigger);
+                }
+            } break;
+            case CP_RULE_AT_MOST: {
+                if(ctx->counts == NULL) {
+                    break;
+                }
+                for(uintmax_t j = 0; j < rule->optc; ++j) {
+                    if(ctx->counts[rule->optv[j]] > rule->max) {
+                        return cp__failRule(ctx, CP_ERR_TOO_MANY_TIMES, rule->optv[j], -1);
+                    }
+                }
+            } break;
+            default: break;
+        }
+    }
+    return true;
+}
+
+// Records the error and returns false, so failure paths can `return cp__fail(...)`.
+bool cp__fail(Cp_Ctx *ctx, Cp_Err_Code code, const Cp_Opt *opt, int offset) {
+    CP__STAT(ctx, errors[code], 1);
+    ctx->err.code = code;
+    ctx->err.argi = ctx->argi;
+    ctx->err.opt = opt != NULL ? (int)(opt - ctx->optv) : -1;
+    ctx->err.other = -1;
+    ctx->err.offset = offset;
+    ctx->err.arg = ctx->arg;
+    return false;
+}
+
+static bool cp__numberError(Cp_Ctx *ctx, Cp__Num_Status status, const Cp_Opt *opt, const char *value) {
+    int offset = (int)(value - ctx->arg);
+    return cp__fail(ctx, status == CP__NUM_RANGE ? CP_ERR_NUMBER_RANGE : CP_ERR_NOT_A_NUMBER, opt, offset);
+}
+
+// Room for one more item at the end of the list of `opt`, growing it if needed. NULL once the error is recorded.
+static void *cp__listPush(Cp_Ctx *ctx, const Cp_Opt *opt, size_t size) {
+    Cp_List *list = (Cp_List*)cp__holder(ctx, opt);
+    if(list->count == list->cap) {
+#ifdef CP_NO_MALLOC
+        cp__fail(ctx, CP_ERR_LIST_FULL, opt, 0);
+        return NULL;
+#else
+        if(list->fixed) {
+            cp__fail(ctx, CP_ERR_LIST_FULL, opt, 0);
+            return NULL;
+        }
+        size_t cap = list->cap ? list->cap * 2 : 8;
+        void *items = CP_REALLOC(list->items, cap * size);
+        if(items == NULL) {
+            cp__fail(ctx, CP_ERR_OUT_OF_MEMORY, opt, 0);
+            return NULL;
+        }
+        list->items = items;
+        list->cap = cap;
+#endif
+    }
+    return (char*)list->items + list->count++ * size;
+}
+
+#ifndef CP_NO_MALLOC
+void cp_freeList(Cp_List *list) {
+    if(!list->fixed) {
+        CP_FREE(list->items);
+        list->items = NULL;
+        list->cap = 0;
+    }
+    list->count = 0;
+}
+#endif
+
+// `len` when it is known, the length of `value` when it is SIZE_MAX.
+static inline size_t cp__valueLen(const char *value, size_t len) {
+    return len != SIZE_MAX ? len : strlen(value);
+}
+
+// Index in `opt->choices` of the one named `value`, whose length is `len` or SIZE_MAX, or -1.
+static int cp__findChoice(const Cp_Ctx *ctx, const Cp_Opt *opt, const char *value, size_t len) {
+    if(ctx->schema != NULL && ctx->schema->choices != NULL) {
+        const Cp__NameTable *table = &ctx->schema->choices[opt - ctx->optv];
+        if(table->count == 0) {
+            return -1;
+        }
+        len = cp__valueLen(value, len);
+        uint32_t hash = cp__hash(value, len);
+        CP__STAT(ctx, comparisons, cp__tableProbes(table, value, len, hash));
+        return cp__tableFind(table, value, len, hash);
+    }
+    if(opt->choices == NULL) {
+        return -1;
+    }
+    for(int i = 0; opt->choices[i].name != NULL; ++i) {
+        CP__STAT(ctx, comparisons, 1);
+        if(opt->choices[i].name[0] == value[0] && cp__streq(opt->choices[i].name, value)) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+// `len` is that of `value`, or SIZE_MAX when only kinds needing it measure it.
+// The option only counts as seen once its value is stored, a rejected one leaves it as it was.
+bool cp__setValueLen(Cp_Ctx *ctx, const Cp_Opt *opt, const char *value, size_t len) {
+    switch(opt->kind) {
+        case OPTK_BOOL: {
+            // only reached for values from outside of the command line, where a flag can't just be present
+            len = cp__valueLen(value, len);
+            bool *holder = (bool*)cp__holder(ctx, opt);
+            if(
+                cp__strEqNoCase(value, len, "1") || cp__strEqNoCase(value, len, "true") ||
+                cp__strEqNoCase(value, len, "yes") || cp__strEqNoCase(value, len, "on")
+            ) {
+                *holder = true;
+            } else if(
+                cp__strEqNoCase(value, len, "0") || cp__strEqNoCase(value, len, "false") ||
+                cp__strEqNoCase(value, len, "no") || cp__strEqNoCase(value, len, "off")
+            ) {
+                *holder = false;
+            } else {
+                return cp__fail(ctx, CP_ERR_NOT_A_BOOL, opt, (int)(value - ctx->arg));
+            }
+        } break;
+        case OPTK_STRING: {
+            *(char**)cp__holder(ctx, opt) = (char*)value;
+        } break;
+        case OPTK_NUMBER:
+        case OPTK_DOUBLE: {
+            CP__STAT(ctx, conversions, 1);
+            Cp__Num_Status status = cp__parseDouble(value, cp__valueLen(value, len), (double*)cp__holder(ctx, opt));
+            if(status != CP__NUM_OK) {
+                return cp__numberError(ctx, status, opt, value);
+            }
+        } break;
+        case OPTK_INT64:
+        case OPTK_COUNT: {
+            // a count from outside of the command line is given as a number
+            CP__STAT(ctx, conversions, 1);
+            Cp__Num_Status status = cp__parseInt64(value, cp__valueLen(value, len), (int64_t*)cp__holder(ctx, opt));
+            if(status != CP__NUM_OK) {
+                return cp__numberError(ctx, status, opt, value);
+            }
+        } break;
+        case OPTK_UINT64: {
+            CP__STAT(ctx, conversions, 1);
+            Cp__Num_Status status = cp__parseUint64(value, cp__valueLen(value, len), (uint64_t*)cp__holder(ctx, opt));
+            if(status != CP__NUM_OK) {
+                return cp__numberError(ctx, status, opt, value);
+            }
+        } break;
+        case OPTK_STRING_LIST: {
+            char **item = (char**)cp__listPush(ctx, opt, sizeof(char*));
+            if(item == NULL) {
+                return false;
+            }
+            *item = (char*)value;
+        } break;
+        case OPTK_NUMBER_LIST: {
+            double number;
+            CP__STAT(ctx, conversions, 1);
+            Cp__Num_Status status = cp__parseDouble(value, cp__valueLen(value, len), &number);
+            if(status != CP__NUM_OK) {
+                return cp__numberError(ctx, status, opt, value);
+            }
+            double *item = (double*)cp__listPush(ctx, opt, sizeof(double));
+            if(item == NULL) {
+                return false;
+            }
+            *item = number;
+        } break;
+        case OPTK_ENUM: {
+            int choice = cp__findChoice(ctx, opt, value, len);
+            if(choice < 0) {
+                return cp__fail(ctx, CP_ERR_UNKNOWN_CHOICE, opt, (int)(value - ctx->arg));
+            }
+            *(int64_t*)cp__holder(ctx, opt) = opt->choices[choice].value;
+        } break;
+        default: {
+            return cp__fail(ctx, CP_ERR_UNKNOWN_KIND, opt, 0); // in theory, unreachable
+        } break;
+    }
+    cp__markSeen(ctx, opt);
+    return true;
+}
+
+bool cp__setValue(Cp_Ctx *ctx, const Cp_Opt *opt, const char *value) {
+    return cp__setValueLen(ctx, opt, value, SIZE_MAX);
+}
+
+// the option was given on the command line, where flags don't take a value
+static void cp__setFlag(Cp_Ctx *ctx, const Cp_Opt *opt) {
+    if(opt->kind == OPTK_COUNT) {
+        ++*(int64_t*)cp__holder(ctx, opt);
+    } else {
+        *(bool*)cp__holder(ctx, opt) = true;
+    }
+    cp__markSeen(ctx, opt);
+}
+
+// the value is the next argument, which may not have arrived yet
+bool cp__awaitValue(Cp_Ctx *ctx, const Cp_Opt *opt) {
+    ctx->pending = (int)(opt - ctx->optv) + 1;
+    return true;
+}
+
+// `arg` points right after the "--" and its name is `name_len` bytes long.
+// `value_len` is the length of what comes after the delimiter, SIZE_MAX when it is not known.
+bool cp__parseLongOpt(Cp_Ctx *ctx, const Cp_Opt *opt, const char *arg, size_t name_len, size_t value_len) {
+    char delim = arg[name_len];
+    if(cp__isFlag(opt->kind)) {
+        if(delim != '\0') {
+            return cp__fail(ctx, CP_ERR_BOOL_TAKES_NO_VALUE, opt, (int)(arg - ctx->arg + name_len));
+        }
+        cp__setFlag(ctx, opt);
+        return true;
+    }
+
+    if(delim != '\0') {
+        return cp__setValueLen(ctx, opt, arg + name_len + 1, value_len);
+    }
+    return cp__awaitValue(ctx, opt);
+}
+// `arg` points right after the '-' and `pos` is where the short name of `opt` is inside of it.
+// `value_len` is the length of what comes after the delimiter, SIZE_MAX when it is not known.
+bool cp__parseShortOpt(Cp_Ctx *ctx, const Cp_Opt *opt, const char *arg, int pos, size_t value_len) {
+    char delim = arg[pos+1];
+    if(cp__isFlag(opt->kind)) {
+        if(delim == '=' || delim == ':') {
+            return cp__fail(ctx, CP_ERR_BOOL_TAKES_NO_VALUE, opt, pos+2);
+        }
+        cp__setFlag(ctx, opt);
+        return true;
+    }
+
+    if(pos > 0) {
+        return cp__fail(ctx, CP_ERR_SHORT_NOT_ISOLATED, opt, pos+1);
+    }
+    if(delim == '\0') {
+        return cp__awaitValue(ctx, opt);
+    }
+    if(delim != '=' && delim != ':') {
+        return cp__fail(ctx, CP_ERR_EXPECTED_ASSIGN, opt, pos+2);
+    }
+    return cp__setValueLen(ctx, opt, arg + pos + 2, value_len);
+}
+
+static const char *cp__kindName(Cp_Opt_Kind kind) {
+    switch(kind) {
+        case OPTK_BOOL: return "bool";
+        case OPTK_NUMBER: return "number";
+        case OPTK_STRING: return "string";
+        case OPTK_INT64: return "int64";
+        case OPTK_UINT64: return "uint64";
+        case OPTK_DOUBLE: return "double";
+        case OPTK_STRING_LIST: return "string list";
+        case OPTK_NUMBER_LIST: return "number list";
+        case OPTK_ENUM: return "enum";
+        case OPTK_COUNT: return "count";
+        default: return "unknown";
+    }
+}
+
+// "a, b or c" into `buf`, cut short with "..." when it does not fit.
+static void cp__joinChoices(const Cp_Choice *choices, char *buf, size_t size) {
+    size_t len = 0;
+    buf[0] = '\0';
+    for(size_t i = 0; choices != NULL && choices[i].name != NULL; ++i) {
+        const char *sep = i == 0 ? "" : choices[i+1].name == NULL ? " or " : ", ";
+        int wrote = snprintf(buf + len, size - len, "%s%s", sep, choices[i].name);
+        if(wrote < 0 || (size_t)wrote >= size - len) {
+            snprintf(buf + (size > 4 ? size - 4 : 0), size > 4 ? 4 : size, "...");
+            return;
+        }
+        len += (size_t)wrote;
+    }
+}
+
+int cp_formatError(const Cp_Ctx *ctx, char *buf, size_t len) {
+    const Cp_Error *err = &ctx->err;
+    const Cp_Opt *opt = err->opt >= 0 ? &ctx->optv[err->opt] : NULL;
+    const Cp_Opt *other = err->other >= 0 ? &ctx->optv[err->other] : NULL;
+    Cp_Error_Info info;
+    info.opt_name = opt != NULL ? opt->name : NULL;
+    info.opt_kind = opt != NULL ? cp__kindName(opt->kind) : NULL;
+    info.other_name = other != NULL ? other->name : NULL;
+    info.config_path = ctx->config_path;
+    info.argumentcap = ctx->argumentcap;
+    info.count = ctx->counts != NULL && err->opt >= 0 ? (unsigned)ctx->counts[err->opt] : 0u;
+    info.choices = opt != NULL ? opt->choices : NULL;
+    return cp_formatErrorInfo(err, &info, buf, len);
+}
+
+int cp_formatErrorInfo(const Cp_Error *err, const Cp_Error_Info *info, char *buf, size_t len) {
+    const char *arg = err->arg != NULL ? err->arg : "";
+    const char *at = arg + err->offset;
+    const char *opt_name = info->opt_name != NULL ? info->opt_name : "";
+    const char *other_name = info->other_name != NULL ? info->other_name : "";
+    char where[96];
+    if(err->argi >= 0) {
+        snprintf(where, sizeof(where), "At argument near %d", err->argi);
+    } else if(err->argi == -2) {
+        snprintf(where, sizeof(where), "In %s:%d", info->config_path != NULL ? info->config_path : "config", err->line);
+    } else {
+        snprintf(where, sizeof(where), "In environment variable %.*s", (int)strcspn(arg, "="), arg);
+    }
+    switch(err->code) {
+        case CP_ERR_NONE:
+            return snprintf(buf, len, "No error.");
+        case CP_ERR_UNKNOWN_LONG:
+            return snprintf(buf, len, "%s: Unknown long argument: '%s'.", where, at);
+        case CP_ERR_UNKNOWN_SHORT:
+            return snprintf(buf, len, "%s: Unknown short argument '%c' in arg: '%s'.", where, *at, arg);
+        case CP_ERR_BOOL_TAKES_NO_VALUE:
+            return snprintf(buf, len, "%s: Argument of type `%s` takes no argument.", where, info->opt_kind != NULL ? info->opt_kind : "bool");
+        case CP_ERR_MISSING_VALUE:
+            return snprintf(buf, len, "%s: Expected argument but got nothing.", where);
+        case CP_ERR_EXPECTED_ASSIGN:
+            return snprintf(buf, len, "%s: Expected either '=', ':' or ' ' to set value. E.g. `flag=this flag:that`.", where);
+        case CP_ERR_SHORT_NOT_ISOLATED:
+            return snprintf(buf, len, "%s: Short opts can only have an argument if isolated.", where);
+        case CP_ERR_NOT_A_NUMBER:
+            return snprintf(buf, len, "%s: Expected a number literal but got '%s'.", where, at);
+        case CP_ERR_NUMBER_RANGE:
+            return snprintf(
+                buf, len, "%s: '%s' does not fit in `%s` for option '%s'.",
+                where, at, info->opt_kind != NULL ? info->opt_kind : "number", opt_name
+            );
+        case CP_ERR_UNKNOWN_KIND:
+            return snprintf(buf, len, "Internal: Unknown option kind.");
+        case CP_ERR_RESPONSE_FILE_DEPTH:
+            return snprintf(buf, len, "%s: Response files nested more than %d deep in '%s'.", where, CP_RESPONSE_FILE_DEPTH, arg);
+        case CP_ERR_RESPONSE_FILE_COUNT:
+            return snprintf(buf, len, "%s: More than %d response files in '%s'.", where, CP_RESPONSE_FILE_MAX, arg);
+        case CP_ERR_OUT_OF_MEMORY:
+            return snprintf(buf, len, "%s: Out of memory.", where);
+        case CP_ERR_LIST_FULL:
+            return snprintf(buf, len, "%s: Option '%s' was given more times than its list can hold.", where, opt_name);
+        case CP_ERR_NOT_A_BOOL:
+            return snprintf(buf, len, "%s: Expected 1/0, true/false, yes/no or on/off for option '%s' but got '%s'.", where, opt_name, at);
+        case CP_ERR_UNKNOWN_KEY:
+            return snprintf(buf, len, "%s: Unknown key '%s'.", where, arg);
+        case CP_ERR_CONFIG_SYNTAX:
+            return snprintf(buf, len, "%s: Expected a \"[section]\" header.", where);
+        case CP_ERR_CONFIG_OPEN:
+            return snprintf(buf, len, "Could not read config file '%s'.", info->config_path != NULL ? info->config_path : "");
+        case CP_ERR_TOO_MANY_ARGUMENTS:
+            return snprintf(buf, len, "%s: Too many arguments, '%s' is past the %d that fit.", where, arg, info->argumentcap);
+        case CP_ERR_MISSING_OPTION:
+            return snprintf(buf, len, "Option '%s' is required.", opt_name);
+        case CP_ERR_EXCLUSIVE_OPTIONS:
+            return snprintf(buf, len, "Options '%s' and '%s' can't be given together.", other_name, opt_name);
+        case CP_ERR_REQUIRED_BY:
+            return snprintf(buf, len, "Option '%s' is required by '%s'.", opt_name, other_name);
+        case CP_ERR_TOO_MANY_TIMES:
+            return snprintf(
+                buf, len, "Option '%s' was given %u times, more than allowed.",
+                opt_name, info->count
+            );
+        case CP_ERR_UNKNOWN_CHOICE: {
+            char choices[256];
+            cp__joinChoices(info->choices, choices, sizeof(choices));
+            return snprintf(buf, len, "%s: Expected %s for option '%s' but got '%s'.", where, choices, opt_name, at);
+        }
+        default:
+            return snprintf(buf, len, "Internal: Unknown error code %d.", (int)err->code);
+    }
+}
+
+// internal usage
+typedef enum {
+    CP__ARG_ERROR = -1,
+    CP__ARG_OPTION,
+    CP__ARG_POSITIONAL,
+    CP__ARG_SUBCOMMAND,
+    CP__ARG_HALT // "--" with `dashdash_halt`, stored by the caller along with the rest
+} Cp__Arg_Result;
+
+// `arg` is `ctx->argv[ctx->argi]`, unless it was fed without an argv.
+bool cp__storeArgument(Cp_Ctx *ctx, const char *arg) {
+    if(ctx->argument_bits != NULL && ctx->argi < ctx->argc) {
+        ctx->argument_bits[ctx->argi / 64] |= (uint64_t)1 << (ctx->argi % 64);
+        ++ctx->argumentc;
+        return true;
+    }
+    if(ctx->argumentc < ctx->argumentcap) {
+        ctx->argumentv[ctx->argumentc++] = (char*)arg;
+        return true;
+    }
+    if(ctx->argumentv != NULL) {
+        return cp__fail(ctx, CP_ERR_TOO_MANY_ARGUMENTS, NULL, 0);
+    }
+    ++ctx->argumentc;
+    return true;
+}
+
+// Handles a single argument, which `ctx->arg` points to and is `len` bytes long, or SIZE_MAX when not known.
+// Shared by `cp_parseUntil` and `cp_feed`. Either `set` or `subcommandv` is used to find subcommands, never both.
+static Cp__Arg_Result cp__parseArg(Cp_Ctx *ctx, const char *arg, size_t len, uintmax_t subcommandc, const char *subcommandv[], const Cp_SubcmdSet *set, const Cp_Command *command) {
+    if(ctx->pending > 0) {
+        const Cp_Opt *opt = &ctx->optv[ctx->pending - 1];
+        ctx->pending = 0;
+        return cp__setValueLen(ctx, opt, arg, len) ? CP__ARG_OPTION : CP__ARG_ERROR;
+    }
+
+    Cp__Token token = cp__lexArg(arg);
+    if(token.kind == CP__TOKEN_DASHDASH) {
+        return ctx->dashdash_halt ? CP__ARG_HALT : CP__ARG_OPTION;
+    } else if(token.kind == CP__TOKEN_LONG) {
+        arg+=2;
+        int j = cp__findLongOpt(ctx, arg, token.name_len, token.hash);
+        if(j < 0) {
+            cp__fail(ctx, CP_ERR_UNKNOWN_LONG, NULL, 2);
+            return CP__ARG_ERROR;
+        }
+        // what follows "--name=", only looked at when there is a delimiter
+        size_t value_len = len != SIZE_MAX ? len - token.name_len - 3 : SIZE_MAX;
+        if(!cp__parseLongOpt(ctx, &ctx->optv[j], arg, token.name_len, value_len)) {
+            return CP__ARG_ERROR;
+        }
+    } else if(token.kind == CP__TOKEN_SHORT) {
+        ++arg;
+        for(int j = 0; arg[j] != '\0'; ++j) {
+            int k = cp__findShortOpt(ctx, arg[j]);
+            if(k < 0) {
+                cp__fail(ctx, CP_ERR_UNKNOWN_SHORT, NULL, j+1);
+                return CP__ARG_ERROR;
+            }
+            // what follows "-n=", only looked at when there is a delimiter
+            size_t value_len = len != SIZE_MAX ? len - (size_t)j - 3 : SIZE_MAX;
+            if(!cp__parseShortOpt(ctx, &ctx->optv[k], arg, j, value_len)) {
+                return CP__ARG_ERROR;
+            }
+            if(arg[j+1] == '=' || arg[j+1] == ':') {
+                // the rest of the arg was the value
+                break;
+            }
+        }
+    } else {
+        // subcommands never start with a dash, so only now it is worth looking for them
+        if(set != NULL) {
+            len = len != SIZE_MAX ? len : strlen(arg);
+            uint32_t hash = cp__hash(arg, len);
+            CP__STAT(ctx, comparisons, cp__tableProbes(&set->names, arg, len, hash));
+            if(cp__tableFind(&set->names, arg, len, hash) >= 0) {
+                return CP__ARG_SUBCOMMAND;
+            }
+        } else if(command != NULL) {
+            for(size_t j = 0; j < command->subc; ++j) {
+                CP__STAT(ctx, comparisons, 1);
+                if(cp__streq(command->subv[j].name, arg)) {
+                    return CP__ARG_SUBCOMMAND;
+                }
+            }
+        } else {
+            for(size_t j = 0; j < subcommandc; ++j) {
+                CP__STAT(ctx, comparisons, 1);
+                if(cp__streq(subcommandv[j], arg)) {
+                    return CP__ARG_SUBCOMMAND;
+                }
+            }
+        }
+        return cp__storeArgument(ctx, arg) ? CP__ARG_POSITIONAL : CP__ARG_ERROR;
+    }
+    return CP__ARG_OPTION;
+}
+
+static int cp__parseUntil(Cp_Ctx *ctx, uintmax_t subcommandc, const char *subcommandv[], const Cp_SubcmdSet *set, const Cp_Command *command) {
+#ifndef CP_NO_MALLOC
+    if(ctx->response_files && !cp__expandResponseFiles(ctx)) {
+        return -1;
+    }
+#endif
+    // Bits are cleared a word at a time right before it gets filled, so they never need zeroing up front.
+    // Parsing may resume halfway through a word, whose earlier bits are kept.
+    if(ctx->argument_bits != NULL && ctx->argi < ctx->argc && ctx->argi % 64 != 0) {
+        ctx->argument_bits[ctx->argi / 64] &= ((uint64_t)1 << (ctx->argi % 64)) - 1;
+    }
+    for(; ctx->argi < ctx->argc; ++ctx->argi) {
+        const char *arg = ctx->argv[ctx->argi];
+        ctx->arg = arg;
+        CP__STAT_TOKEN(ctx, arg, SIZE_MAX);
+        if(ctx->argument_bits != NULL && ctx->argi % 64 == 0) {
+            ctx->argument_bits[ctx->argi / 64] = 0;
+        }
+
+        Cp__Arg_Result result = cp__parseArg(ctx, arg, SIZE_MAX, subcommandc, subcommandv, set, command);
+        if(result == CP__ARG_ERROR) {
+            return -1;
+        }
+        if(result == CP__ARG_SUBCOMMAND) {
+            return ctx->argi;
+        }
+        if(result == CP__ARG_HALT) {
+            for(; ctx->argi < ctx->argc; ++ctx->argi) {
+                ctx->arg = ctx->argv[ctx->argi];
+                if(!cp__storeArgument(ctx, ctx->arg)) {
+                    return -1;
+                }
+            }
+            return ctx->argi;
+        }
+    }
+
+    if(ctx->pending > 0) {
+        // blame the option, which was the last argument
+        --ctx->argi;
+        cp__fail(ctx, CP_ERR_MISSING_VALUE, &ctx->optv[ctx->pending - 1], 0);
+        ctx->pending = 0;
+        return -1;
+    }
+    return ctx->argi;
+}
+
+#ifdef CP_ENABLE_STATS
+static int cp__parseUntilTimed(Cp_Ctx *ctx, uintmax_t subcommandc, const char *subcommandv[], const Cp_SubcmdSet *set, const Cp_Command *command) {
+    if(ctx->stats == NULL) {
+        return cp__parseUntil(ctx, subcommandc, subcommandv, set, command);
+    }
+    uint64_t start = cp__nowNs();
+    int stopped = cp__parseUntil(ctx, subcommandc, subcommandv, set, command);
+    ctx->stats->parse_ns += cp__nowNs() - start;
+    return stopped;
+}
+#endif
+
+// Checks the rules once parsing stopped without an error.
+static int cp__parseDone(Cp_Ctx *ctx, int stopped) {
+    if(stopped >= 0 && ctx->rules != NULL && !cp_checkRules(ctx, ctx->rules)) {
+        return -1;
+    }
+    return stopped;
+}
+
+// returns where it stopped parsing `ctx->argv`, 0-indexed, or -1 for parsing error
+int cp_parseUntil(Cp_Ctx *ctx, uintmax_t subcommandc, const char *subcommandv[]) {
+    return cp__parseDone(ctx, CP__PARSE_UNTIL(ctx, subcommandc, subcommandv, NULL, NULL));
+}
+int cp_parseUntilSet(Cp_Ctx *ctx, const Cp_SubcmdSet *set) {
+    return cp__parseDone(ctx, CP__PARSE_UNTIL(ctx, 0, NULL, set, NULL));
+}
+
+// Zeroes the seen bits for a subcommand's table of `optc` options, reusing the words of `seen` when they are enough.
+static bool cp__resetSeen(Cp_Ctx *ctx, uintmax_t optc) {
+    memset(ctx->seen_inline, 0, sizeof(ctx->seen_inline));
+    size_t need = CP_OPTION_WORDS(optc);
+    if(ctx->seen != NULL && need <= ctx->seen_words) {
+        memset(ctx->seen, 0, ctx->seen_words * sizeof(uint64_t));
+        return true;
+    }
+    if(ctx->seen == NULL && optc <= CP_SEEN_INLINE) {
+        return true;
+    }
+#ifndef CP_NO_MALLOC
+    uint64_t *seen = (uint64_t*)CP_CALLOC(need, sizeof(uint64_t));
+    if(seen == NULL) {
+        return cp__fail(ctx, CP_ERR_OUT_OF_MEMORY, NULL, 0);
+    }
+    CP_FREE(ctx->seen_owned);
+    ctx->seen_owned = seen;
+    ctx->seen = seen;
+    ctx->seen_words = need;
+#else
+    // nothing to grow them with, so the options of this table are not tracked
+    ctx->seen = NULL;
+    ctx->seen_words = 0;
+#endif
+    return true;
+}
+
+const Cp_Command *cp_parseCommand(Cp_Ctx *ctx, const Cp_Command *command) {
+    ctx->command_argument = 0;
+    if(ctx->seen != NULL && ctx->seen_words == 0) {
+        ctx->seen_words = CP_OPTION_WORDS(ctx->optc);
+    }
+    // the context may have been made for a smaller table than the root's
+    bool fits = ctx->seen != NULL ? CP_OPTION_WORDS(command->optc) <= ctx->seen_words : command->optc <= CP_SEEN_INLINE;
+    if(!fits && !cp__resetSeen(ctx, command->optc)) {
+        return NULL;
+    }
+    while(true) {
+        ctx->optc = command->optc;
+        ctx->optv = command->optv;
+        ctx->schema = command->schema;
+        ctx->rules = command->rules;
+        if(ctx->counts != NULL) {
+            memset(ctx->counts, 0, command->optc * sizeof(uint32_t));
+        }
+        int stopped = cp__parseDone(ctx, CP__PARSE_UNTIL(ctx, 0, NULL, command->set, command));
+        if(stopped < 0) {
+            return NULL;
+        }
+        if(stopped >= ctx->argc) {
+            return command;
+        }
+        const char *name = ctx->argv[stopped];
+        uintmax_t i = 0;
+        if(command->set != NULL) {
+            i = (uintmax_t)cp_findSubcommand(command->set, name);
+        } else {
+            while(!cp__streq(command->subv[i].name, name)) ++i;
+        }
+        command = &command->subv[i];
+        // the bits were about the parent's table
+        if(!cp__resetSeen(ctx, command->optc)) {
+            return NULL;
+        }
+        ctx->command_argument = ctx->argumentc;
+        ++ctx->argi;
+    }
+}
+
+int cp_runCommand(Cp_Ctx *ctx, const Cp_Command *root) {
+    const Cp_Command *command = cp_parseCommand(ctx, root);
+    if(command == NULL || command->handler == NULL) {
+        return -1;
+    }
+    return command->handler(ctx, command);
+}
+
+char **cp_commandArguments(const Cp_Ctx *ctx, int *count) {
+    *count = ctx->argumentc - ctx->command_argument;
+    return ctx->argumentv != NULL ? ctx->argumentv + ctx->command_argument : NULL;
+}
+
+int cp_parse(Cp_Ctx *ctx) {
+    return cp_parseUntil(ctx, 0, NULL);
+}
+
+int cp_parseInto(const Cp_Schema *schema, int argc, char *argv[], void *record, Cp_Error *err) {
+    Cp_Ctx ctx;
+    if(schema == NULL || record == NULL || !cp_initCtx(&ctx, argc, argv, schema->optc, schema->optv, 0, NULL)) {
+        return -1;
+    }
+    ctx.schema = schema;
+    ctx.record = record;
+    int stopped = cp_parse(&ctx);
+    if(err != NULL) {
+        *err = ctx.err;
+    }
+    return stopped < 0 ? -1 : ctx.argumentc;
+}
+
+int cp_nextArgument(const Cp_Ctx *ctx, int from) {
+    if(ctx->argument_bits == NULL || from < 0) {
+        return -1;
+    }
+    // only what was parsed so far has meaningful bits
+    int end = ctx->argi < ctx->argc ? ctx->argi : ctx->argc;
+    if(from >= end) {
+        return -1;
+    }
+    size_t word = (size_t)from / 64;
+    uint64_t bits = ctx->argument_bits[word] & (~(uint64_t)0 << (from % 64));
+    size_t words = CP_ARGUMENT_WORDS(end);
+    while(bits == 0) {
+        if(++word >= words) {
+            return -1;
+        }
+        bits = ctx->argument_bits[word];
+    }
+    int i = (int)(word * 64 + (size_t)cp__ctz64(bits));
+    return i < end ? i : -1;
+}
+
+int cp_feed(Cp_Ctx *ctx, const char *token, size_t len) {
+    Cp__Arg_Result result = CP__ARG_POSITIONAL;
+    ctx->arg = token;
+    CP__STAT_TOKEN(ctx, token, len);
+    if(!ctx->halted) {
+        // with the length known, values don't get measured again
+        result = cp__parseArg(ctx, token, len, 0, NULL, NULL, NULL);
+        ctx->halted = result == CP__ARG_HALT;
+    }
+    if(ctx->halted) {
+        result = cp__storeArgument(ctx, token) ? CP__ARG_POSITIONAL : CP__ARG_ERROR;
+    }
+    ++ctx->argi;
+    if(result == CP__ARG_ERROR) {
+        return -1;
+    }
+    return result == CP__ARG_POSITIONAL;
+}
+
+bool cp_finish(Cp_Ctx *ctx) {
+    if(ctx->pending == 0) {
+        return ctx->rules == NULL || cp_checkRules(ctx, ctx->rules);
+    }
+    // the option was the last token, which may be gone by now
+    --ctx->argi;
+    ctx->arg = NULL;
+    cp__fail(ctx, CP_ERR_MISSING_VALUE, &ctx->optv[ctx->pending - 1], 0);
+    ctx->pending = 0;
+    return false;
+}
+
+#ifdef _WIN32
+#define cp__environ _environ
+#else
+extern char **environ;
+#define cp__environ environ
+#endif
+
+bool cp_applyEnv(Cp_Ctx *ctx, char **envp) {
+    if(envp == NULL) {
+        envp = cp__environ;
+    }
+    if(envp == NULL) {
+        return true;
+    }
+    int argi = ctx->argi;
+    const char *arg = ctx->arg;
+    ctx->argi = -1; // errors are blamed on the environment
+    bool ok = true;
+    if(ctx->schema != NULL) {
+        for(char **entry = envp; ok && *entry != NULL; ++entry) {
+            const char *var = *entry;
+            uint32_t hash = 2166136261u;
+            size_t len = 0;
+            for(; var[len] != '\0' && var[len] != '='; ++len) {
+                hash = (hash ^ (unsigned char)var[len]) * 16777619u;
+            }
+            if(var[len] != '=') continue;
+            int i = cp__tableFind(&ctx->schema->envs, var, len, hash);
+            // a variable present twice keeps its first value, same as `getenv`
+            if(i < 0 || cp_seen(ctx, i)) continue;
+            ctx->arg = var;
+            ok = cp__setValue(ctx, &ctx->optv[i], var + len + 1);
+        }
+    } else {
+        for(uintmax_t i = 0; ok && i < ctx->optc; ++i) {
+            const char *env = ctx->optv[i].env;
+            if(env == NULL || cp_seen(ctx, (int)i)) continue;
+            size_t len = strlen(env);
+            for(char **entry = envp; *entry != NULL; ++entry) {
+                if(strncmp(*entry, env, len) == 0 && (*entry)[len] == '=') {
+                    ctx->arg = *entry;
+                    ok = cp__setValue(ctx, &ctx->optv[i], *entry + len + 1);
+                    break;
+                }
+            }
+        }
+    }
+    ctx->argi = argi;
+    ctx->arg = arg;
+    return ok;
+}
+
+// internal usage
+// Whether `name` is `section.key`, or just `key` when there is no section.
+static bool cp__isSectionKey(const char *name, const char *section, size_t section_len, const char *key, size_t key_len) {
+    if(section_len > 0) {
+        if(strncmp(name, section, section_len) != 0 || name[section_len] != '.') return false;
+        name += section_len + 1;
+    }
+    return strncmp(name, key, key_len) == 0 && name[key_len] == '\0';
+}
+
+// Finds the option named `section.key` without needing the two next to each other, `hash` covers the whole name.
+static int cp__findSectionKey(const Cp_Ctx *ctx, const char *section, size_t section_len, const char *key, size_t key_len, uint32_t hash) {
+    if(ctx->schema != NULL) {
+        const Cp__NameTable *table = &ctx->schema->longs;
+        size_t len = section_len > 0 ? section_len + 1 + key_len : key_len;
+        uint32_t slot = hash & table->mask;
+        uint32_t entry;
+        while((entry = table->slots[slot]) != 0) {
+            --entry;
+            if(table->lens[entry] == len && cp__isSectionKey(table->names[entry], section, section_len, key, key_len)) {
+                return (int)entry;
+            }
+            slot = (slot+1) & table->mask;
+        }
+        return -1;
+    }
+    for(size_t i = 0; i < ctx->optc; ++i) {
+        const char *name = ctx->optv[i].name;
+        if(name != NULL && cp__isSectionKey(name, section, section_len, key, key_len)) {
+            return (int)i;
+        }
+    }
+    return -1;
+}
+
+// Parses the lines of `text`, which belongs to `file` unless that is NULL.
+// `before` has the seen bits from the earlier layers, NULL to check the live ones.
+static bool cp__parseConfigText(Cp_Ctx *ctx, char *text, size_t len, struct Cp__File *file, const uint64_t *before) {
+    char *at = text;
+    char *end = text + len;
+    const char *section = NULL;
+    size_t section_len = 0;
+    uint32_t section_hash = 2166136261u; // FNV-1a state after "section.", so keys continue from it
+    int line = 0;
+    for(; at < end; ++line) {
+        char *eol = (char*)memchr(at, '\n', (size_t)(end - at));
+        if(eol == NULL) eol = end;
+        char *next = eol < end ? eol + 1 : end;
+        ctx->err.line = line + 1;
+
+        char *stop = eol;
+        while(at < stop && cp__isSpace(*at)) ++at;
+        while(stop > at && cp__isSpace(stop[-1])) --stop;
+        if(at == stop || *at == '#' || *at == ';') {
+            at = next;
+            continue;
+        }
+        ctx->arg = at;
+
+        if(*at == '[') {
+            if(stop[-1] != ']') {
+                return cp__fail(ctx, CP_ERR_CONFIG_SYNTAX, NULL, 0);
+            }
+            char *name = at + 1;
+            char *name_end = stop - 1;
+            while(name < name_end && cp__isSpace(*name)) ++name;
+            while(name_end > name && cp__isSpace(name_end[-1])) --name_end;
+            section = name;
+            section_len = (size_t)(name_end - name);
+            section_hash = 2166136261u;
+            if(section_len > 0) {
+                section_hash = (cp__hash(section, section_len) ^ (unsigned char)'.') * 16777619u;
+            }
+            at = next;
+            continue;
+        }
+
+        char *eq = (char*)memchr(at, '=', (size_t)(stop - at));
+        char *key_end = eq != NULL ? eq : stop;
+        while(key_end > at && cp__isSpace(key_end[-1])) --key_end;
+        uint32_t hash = section_hash;
+        for(const char *c = at; c < key_end; ++c) {
+            hash = (hash ^ (unsigned char)*c) * 16777619u;
+        }
+        int i = cp__findSectionKey(ctx, section, section_len, at, (size_t)(key_end - at), hash);
+        if(i < 0) {
+            ctx->arg = cp__terminate(file, at, key_end);
+            return cp__fail(ctx, ctx->arg != NULL ? CP_ERR_UNKNOWN_KEY : CP_ERR_OUT_OF_MEMORY, NULL, 0);
+        }
+        const Cp_Opt *opt = &ctx->optv[i];
+        bool earlier = before != NULL ? (before[i / 64] >> (i % 64)) & 1 : cp_seen(ctx, i);
+        if(earlier) {
+            at = next;
+            continue;
+        }
+
+        const char *value;
+        if(eq == NULL) {
+            if(!cp__isFlag(opt->kind)) {
+                return cp__fail(ctx, CP_ERR_MISSING_VALUE, opt, 0);
+            }
+            value = "1";
+        } else {
+            char *start = eq + 1;
+            char *value_end = stop;
+            while(start < value_end && cp__isSpace(*start)) ++start;
+            // quotes keep the spaces around a value
+            if(value_end - start >= 2 && (*start == '"' || *start == '\'') && value_end[-1] == *start) {
+                ++start;
+                --value_end;
+            }
+            value = cp__terminate(file, start, value_end);
+            if(value == NULL) {
+                return cp__fail(ctx, CP_ERR_OUT_OF_MEMORY, opt, 0);
+            }
+            ctx->arg = value;
+        }
+        if(!cp__setValue(ctx, opt, value)) {
+            return false;
+        }
+        at = next;
+    }
+    return true;
+}
+
+static bool cp__applyConfig(Cp_Ctx *ctx, char *text, size_t len, struct Cp__File *file) {
+    // a copy of the seen bits, so keys repeated inside of the file are told apart from earlier layers
+    uint64_t inline_before[CP_SEEN_INLINE / 64];
+    uint64_t *before = NULL;
+    const uint64_t *seen = cp__seenWords(ctx);
+    size_t words = CP_OPTION_WORDS(ctx->optc);
+    if(seen != NULL && words <= CP_SEEN_INLINE / 64) {
+        before = inline_before;
+    }
+#ifndef CP_NO_MALLOC
+    else if(seen != NULL) {
+        before = (uint64_t*)CP_CALLOC(words, sizeof(uint64_t));
+        if(before == NULL) {
+            return cp__fail(ctx, CP_ERR_OUT_OF_MEMORY, NULL, 0);
+        }
+    }
+#endif
+    if(before != NULL) {
+        memcpy(before, seen, words * sizeof(uint64_t));
+    }
+
+    int argi = ctx->argi;
+    const char *arg = ctx->arg;
+    ctx->argi = -2; // errors are blamed on the config file
+    bool ok = cp__parseConfigText(ctx, text, len, file, before);
+    ctx->argi = argi;
+    ctx->arg = arg;
+#ifndef CP_NO_MALLOC
+    if(before != inline_before) {
+        CP_FREE(before);
+    }
+#endif
+    return ok;
+}
+
+bool cp_parseConfig(Cp_Ctx *ctx, char *text, size_t len) {
+    ctx->config_path = NULL;
+    return cp__applyConfig(ctx, text, len, NULL);
+}
+
+#ifndef CP_NO_MALLOC
+bool cp_parseConfigFile(Cp_Ctx *ctx, const char *path) {
+    ctx->config_path = path;
+    struct Cp__File *file;
+    bool loaded = cp__loadFile(path, &file);
+    if(!loaded || file == NULL) {
+        int argi = ctx->argi;
+        ctx->argi = -2;
+        ctx->err.line = 0;
+        cp__fail(ctx, loaded ? CP_ERR_CONFIG_OPEN : CP_ERR_OUT_OF_MEMORY, NULL, 0);
+        ctx->argi = argi;
+        return false;
+    }
+    file->next = ctx->files;
+    ctx->files = file;
+// only a hint, strict C builds without _DEFAULT_SOURCE don't declare it
+#if defined(CP__HAS_MMAP) && defined(MADV_SEQUENTIAL)
+    if(file->mapped) {
+        madvise(file->data, file->len, MADV_SEQUENTIAL);
+    }
+#endif
+    return cp__applyConfig(ctx, file->data, file->len, file);
+}
+#endif
+
+// internal usage
+// Bytes `cp_tokenize` has to stop at outside of quotes.
+static inline bool cp__isShellSpecial(char c) {
+    return cp__isSpace(c) || c == '\'' || c == '"' || c == '\\';
+}
+
+#if defined(__AVX2__) && !defined(CP_NO_SIMD)
+// Bit `i` is set for whitespace at `p[i]`, `*special` also gets quotes and backslashes.
+static inline uint32_t cp__classify(const char *p, uint32_t *special) {
+    __m256i v = _mm256_loadu_si256((const __m256i*)p);
+    // '\t' to '\r' are contiguous, so `v - '\t' <= 4` catches all of them with one unsigned compare
+    __m256i ctl = _mm256_sub_epi8(v, _mm256_set1_epi8('\t'));
+    __m256i space = _mm256_cmpeq_epi8(_mm256_min_epu8(ctl, _mm256_set1_epi8(4)), ctl);
+    space = _mm256_or_si256(space, _mm256_cmpeq_epi8(v, _mm256_set1_epi8(' ')));
+    __m256i quote = _mm256_or_si256(
+        _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\'')),
+        _mm256_cmpeq_epi8(v, _mm256_set1_epi8('"'))
+    );
+    quote = _mm256_or_si256(quote, _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\\')));
+    *special = (uint32_t)_mm256_movemask_epi8(_mm256_or_si256(space, quote));
+    return (uint32_t)_mm256_movemask_epi8(space);
+}
+#define CP__SIMD_WIDTH 32
+#elif defined(__SSE2__) && !defined(CP_NO_SIMD)
+static inline uint32_t cp__classify16(const char *p, uint32_t *special) {
+    __m128i v = _mm_loadu_si128((const __m128i*)p);
+    // '\t' to '\r' are contiguous, so `v - '\t' <= 4` catches all of them with one unsigned compare
+    __m128i ctl = _mm_sub_epi8(v, _mm_set1_epi8('\t'));
+    __m128i space = _mm_cmpeq_epi8(_mm_min_epu8(ctl, _mm_set1_epi8(4)), ctl);
+    space = _mm_or_si128(space, _mm_cmpeq_epi8(v, _mm_set1_epi8(' ')));
+    __m128i quote = _mm_or_si128(
+        _mm_cmpeq_epi8(v, _mm_set1_epi8('\'')),
+        _mm_cmpeq_epi8(v, _mm_set1_epi8('"'))
+    );
+    quote = _mm_or_si128(quote, _mm_cmpeq_epi8(v, _mm_set1_epi8('\\')));
+    *special = (uint32_t)_mm_movemask_epi8(_mm_or_si128(space, quote));
+    return (uint32_t)_mm_movemask_epi8(space);
+}
+// Same as the AVX2 version, two halves at a time so a block holds as many bytes.
+static inline uint32_t cp__classify(const char *p, uint32_t *special) {
+    uint32_t special_lo, special_hi;
+    uint32_t space = cp__classify16(p, &special_lo) | cp__classify16(p + 16, &special_hi) << 16;
+    *special = special_lo | special_hi << 16;
+    return space;
+}
+#define CP__SIMD_WIDTH 32
+#endif
+
+// First index from `i` on that is not whitespace, or `len`.
+static size_t cp__skipSpace(const char *str, size_t i, size_t len) {
+#ifdef CP__SIMD_WIDTH
+    for(; i + CP__SIMD_WIDTH <= len; i += CP__SIMD_WIDTH) {
+        uint32_t special;
+        uint32_t other = ~cp__classify(str + i, &special);
+        if(other != 0) {
+            return i + cp__ctz32(other);
+        }
+    }
+#endif
+    while(i < len && cp__isSpace(str[i])) ++i;
+    return i;
+}
+
+// First index from `i` on holding whitespace, a quote or a backslash, or `len`.
+static size_t cp__scanSpecial(const char *str, size_t i, size_t len) {
+#ifdef CP__SIMD_WIDTH
+    for(; i + CP__SIMD_WIDTH <= len; i += CP__SIMD_WIDTH) {
+        uint32_t special;
+        cp__classify(str + i, &special);
+        if(special != 0) {
+            return i + cp__ctz32(special);
+        }
+    }
+#endif
+    while(i < len && !cp__isShellSpecial(str[i])) ++i;
+    return i;
+}
+
+int cp_tokenize(char *str, size_t len, int argcap, char *argv[]) {
+    int argc = 0;
+    size_t i = 0;
+    // an argument started before `i` and still goes on, with nothing removed from it so far
+    bool in_arg = false;
+    while(true) {
+#ifdef CP__SIMD_WIDTH
+        // Blocks without quotes or backslashes are split a whole block at a time:
+        // arguments start at whitespace to non-whitespace edges and end at the opposite ones.
+        uint32_t carry = in_arg ? 0 : 1; // whether the byte before the block is whitespace
+        for(; i + CP__SIMD_WIDTH <= len; i += CP__SIMD_WIDTH) {
+            uint32_t special;
+            uint32_t space = cp__classify(str + i, &special);
+            if(special != space) break;
+            uint32_t before = (space << 1) | carry;
+            uint32_t starts = ~space & before;
+            uint32_t ends = space & ~before;
+            carry = space >> (CP__SIMD_WIDTH - 1);
+            if(argc + cp__popcount32(starts) > argcap) return -1;
+            for(; starts != 0; starts &= starts - 1) {
+                argv[argc++] = str + i + cp__ctz32(starts);
+            }
+            for(; ends != 0; ends &= ends - 1) {
+                str[i + cp__ctz32(ends)] = '\0';
+            }
+        }
+        in_arg = carry == 0;
+#endif
+        if(!in_arg) {
+            i = cp__skipSpace(str, i, len);
+            if(i >= len) break;
+            if(argc >= argcap) return -1;
+            argv[argc++] = str + i;
+        }
+        in_arg = false;
+
+        // `w` trails behind `i` once quotes or escapes were removed
+        size_t w = i;
+        while(true) {
+            size_t j = cp__scanSpecial(str, i, len);
+            if(w != i) memmove(str + w, str + i, j - i);
+            w += j - i;
+            i = j;
+            if(i >= len || cp__isSpace(str[i])) break;
+
+            char c = str[i++];
+            if(c == '\\') {
+                if(i >= len) {
+                    str[w++] = c; // nothing left to escape, keep it
+                } else if(str[i] == '\n') {
+                    ++i; // line continuation
+                } else {
+                    str[w++] = str[i++];
+                }
+            } else if(c == '\'') {
+                const char *close = (const char*)memchr(str + i, '\'', len - i);
+                if(close == NULL) return -2;
+                size_t n = (size_t)(close - (str + i));
+                memmove(str + w, str + i, n);
+                w += n;
+                i += n + 1;
+            } else { // '"'
+                while(true) {
+                    if(i >= len) return -2;
+                    c = str[i++];
+                    if(c == '"') break;
+                    if(c == '\\' && i < len) {
+                        char next = str[i];
+                        if(next == '\n') {
+                            ++i;
+                            continue;
+                        }
+                        if(next == '$' || next == '`' || next == '"' || next == '\\') {
+                            c = next;
+                            ++i;
+                        }
+                    }
+                    str[w++] = c;
+                }
+            }
+        }
+        // `w` is never past `i`, so this only overwrites bytes already consumed or the whitespace that ended the argument
+        str[w] = '\0';
+        if(i < len) ++i;
+    }
+    return argc;
+}
+
+#ifdef CP_ENABLE_BATCH
+
+size_t cp_countLines(const char *buf, size_t len, char separator) {
+    size_t lines = 0;
+    const char *end = buf + len;
+    const char *at = buf;
+    while(at < end) {
+        ++lines;
+        at = (const char*)memchr(at, separator, end - at);
+        if(at == NULL) break;
+        ++at;
+    }
+    return lines;
+}
+
+// internal usage
+// Lines are handed out in chunks of bytes, a line belongs to the chunk where it starts.
+#define CP__BATCH_CHUNK ((size_t)1 << 16)
+
+typedef struct {
+    const Cp_Schema *schema;
+    char *buf;
+    size_t len;
+    char separator;
+    size_t chunkc;
+    size_t *first_line; // per chunk, index of its first line
+    size_t *first_byte; // per chunk, offset of its first line start or `len` if it has none
+    Cp_Value *valuev;
+    Cp_Error *errv;
+    atomic_size_t next_chunk;
+    atomic_bool failed;
+} Cp__Batch;
+
+// Splits `line` on whitespace in place. Grows `*argv` as needed, returns -1 if that fails.
+static int cp__splitLine(char *line, size_t len, char ***argv, size_t *cap) {
+    int argc = 0;
+    size_t i = 0;
+    while(true) {
+        while(i < len && cp__isSpace(line[i])) ++i;
+        if(i >= len) break;
+        if((size_t)argc+1 >= *cap) {
+            size_t new_cap = *cap ? *cap * 2 : 64;
+            char **grown = (char**)CP_REALLOC(*argv, new_cap * sizeof(char*));
+            if(grown == NULL) return -1;
+            *argv = grown;
+            *cap = new_cap;
+        }
+        (*argv)[argc++] = line + i;
+        while(i < len && !cp__isSpace(line[i])) ++i;
+        if(i >= len) break;
+        line[i++] = '\0';
+    }
+    return argc;
+}
+
+// Phase one: where every chunk's lines start and how many there are.
+static void cp__batchCount(Cp__Batch *batch) {
+    size_t chunk;
+    while((chunk = atomic_fetch_add(&batch->next_chunk, 1)) < batch->chunkc) {
+        size_t start = chunk * CP__BATCH_CHUNK;
+        size_t end = start + CP__BATCH_CHUNK < batch->len ? start + CP__BATCH_CHUNK : batch->len;
+        size_t lines = 0;
+        size_t first = batch->len;
+        // a line starts at 0 or right after a separator
+        size_t at = start;
+        if(start != 0) {
+            const char *sep = (const char*)memchr(batch->buf + start - 1, batch->separator, end - start + 1);
+            at = sep != NULL ? (size_t)(sep - batch->buf) + 1 : end;
+        }
+        while(at < end) {
+            if(first == batch->len) first = at;
+            ++lines;
+            const char *sep = (const char*)memchr(batch->buf + at, batch->separator, end - at);
+            if(sep == NULL) break;
+            at = (size_t)(sep - batch->buf) + 1;
+        }
+        batch->first_line[chunk] = lines; // turned into a prefix sum afterwards
+        batch->first_byte[chunk] = first;
+    }
+}
+
+// Phase two: every line of a chunk goes through a private context that writes into its own row.
+static void cp__batchParse(Cp__Batch *batch) {
+    const Cp_Schema *schema = batch->schema;
+    char **argv = NULL;
+    size_t argv_cap = 0;
+    size_t chunk;
+    while((chunk = atomic_fetch_add(&batch->next_chunk, 1)) < batch->chunkc) {
+        size_t end = (chunk+1) * CP__BATCH_CHUNK < batch->len ? (chunk+1) * CP__BATCH_CHUNK : batch->len;
+        size_t line = batch->first_line[chunk];
+        size_t at = batch->first_byte[chunk];
+        while(at < end) {
+            char *start = batch->buf + at;
+            char *sep = memchr(start, batch->separator, batch->len - at);
+            size_t line_len = sep != NULL ? (size_t)(sep - start) : batch->len - at;
+            at += line_len + 1;
+
+            Cp_Value *values = batch->valuev + line * schema->optc;
+            Cp_Error *err = &batch->errv[line];
+            memset(values, 0, schema->optc * sizeof(Cp_Value));
+            cp__clearError(err);
+            ++line;
+
+            int argc = cp__splitLine(start, line_len, &argv, &argv_cap);
+            if(argc < 0) {
+                atomic_store(&batch->failed, true);
+                break;
+            }
+            if(argc == 0) {
+                continue;
+            }
+            // the last argument ends at the separator
+            if(sep != NULL) *sep = '\0';
+            argv[argc] = NULL;
+
+            Cp_Ctx ctx;
+            cp_initCtx(&ctx, argc, argv, schema->optc, schema->optv, 0, NULL);
+            ctx.schema = schema;
+            ctx.valuev = values;
+            if(cp_parse(&ctx) == -1) {
+                *err = ctx.err;
+            }
+        }
+    }
+    CP_FREE(argv);
+}
+
+static void cp__batchRun(Cp__Batch *batch, int threadc, void *(*worker)(void*)) {
+    pthread_t *threads = CP_CALLOC(threadc, sizeof(pthread_t));
+    int started = 0;
+    if(threads != NULL) {
+        for(; started < threadc-1; ++started) {
+            if(pthread_create(&threads[started], NULL, worker, batch) != 0) {
+                break;
+            }
+        }
+    }
+    // the calling thread works too, so a failed spawn only costs parallelism
+    worker(batch);
+    for(int i = 0; i < started; ++i) {
+        pthread_join(threads[i], NULL);
+    }
+    CP_FREE(threads);
+}
+static void *cp__batchCountWorker(void *batch) {
+    cp__batchCount(batch);
+    return NULL;
+}
+static void *cp__batchParseWorker(void *batch) {
+    cp__batchParse(batch);
+    return NULL;
+}
+
+long cp_parseBatch(
+    const Cp_Schema *schema, char *buf, size_t len, char separator, int threadc,
+    size_t linecap, Cp_Value valuev[], Cp_Error errv[]
+) {
+    if(schema == NULL || (buf == NULL && len != 0)) {
+        return -1;
+    }
+    if(threadc <= 0) {
+        long cores = sysconf(_SC_NPROCESSORS_ONLN);
+        threadc = cores > 0 ? (int)cores : 1;
+    }
+
+    Cp__Batch batch;
+    memset(&batch, 0, sizeof(batch));
+    batch.schema = schema;
+    batch.buf = buf;
+    batch.len = len;
+    batch.separator = separator;
+    batch.chunkc = (len + CP__BATCH_CHUNK - 1) / CP__BATCH_CHUNK;
+    batch.valuev = valuev;
+    batch.errv = errv;
+    batch.first_line = CP_CALLOC(batch.chunkc*2 + 1, sizeof(size_t));
+    if(batch.first_line == NULL) {
+        return -1;
+    }
+    batch.first_byte = batch.first_line + batch.chunkc;
+    if((size_t)threadc > batch.chunkc) {
+        threadc = batch.chunkc > 0 ? (int)batch.chunkc : 1;
+    }
+
+    atomic_init(&batch.next_chunk, 0);
+    atomic_init(&batch.failed, false);
+    cp__batchRun(&batch, threadc, cp__batchCountWorker);
+
+    size_t lines = 0;
+    for(size_t i = 0; i < batch.chunkc; ++i) {
+        size_t count = batch.first_line[i];
+        batch.first_line[i] = lines;
+        lines += count;
+    }
+    if(lines > linecap || lines > LONG_MAX) {
+        CP_FREE(batch.first_line);
+        return -1;
+    }
+
+    atomic_store(&batch.next_chunk, 0);
+    cp__batchRun(&batch, threadc, cp__batchParseWorker);
+    CP_FREE(batch.first_line);
+    return atomic_load(&batch.failed) ? -1 : (long)lines;
+}
+
+#endif
+
+#ifdef CP_ENABLE_CODEGEN
+
+// internal usage
+// Writes `len` bytes of `str` as a C string literal.
+static void cp__emitString(FILE *out, const char *str, size_t len) {
+    fputc('"', out);
+    for(size_t i = 0; i < len; ++i) {
+        unsigned char c = (unsigned char)str[i];
+        if(c == '"' || c == '\\' || c == '?') {
+            fprintf(out, "\\%c", c);
+        } else if(c >= 0x20 && c < 0x7f) {
+            fputc(c, out);
+        } else {
+            fprintf(out, "\\%03o", c);
+        }
+    }
+    fputc('"', out);
+}
+
+// Smallest unsigned type holding every option index plus one.
+static const char *cp__emitIndexType(uintmax_t optc) {
+    if(optc < UINT8_MAX) return "uint8_t";
+    if(optc < UINT16_MAX) return "uint16_t";
+    return "uint32_t";
+}
+
+// Byte of `name` a lookup key is made of. A `pos` below zero counts from the end, -1 being the last byte,
+// and a position past the name reads as zero.
+static unsigned char cp__keyByte(const char *name, size_t len, int pos) {
+    if(pos >= 0) {
+        return (size_t)pos < len ? (unsigned char)name[pos] : 0;
+    }
+    size_t back = (size_t)(-pos - 1);
+    return back < len ? (unsigned char)name[len - 1 - back] : 0;
+}
+
+static uint64_t cp__lookupKey(const char *name, int posc, const int posv[]) {
+    size_t len = strlen(name);
+    uint64_t key = len;
+    for(int i = 0; i < posc; ++i) {
+        key = key << 8 | cp__keyByte(name, len, posv[i]);
+    }
+    return key;
+}
+
+static int cp__compareKeys(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t*)a, y = *(const uint64_t*)b;
+    return (x > y) - (x < y);
+}
+
+#define CP__KEY_POSITIONS 7
+
+// Picks the byte positions that, with the length, tell the most long names apart, the way gperf does,
+// so a lookup hashes a handful of bytes instead of the whole name. Returns how many were picked.
+static int cp__pickKeyPositions(const Cp_Opt optv[], const uint32_t longv[], size_t longc, uint64_t *keys, int posv[]) {
+    size_t maxlen = 0;
+    for(size_t i = 0; i < longc; ++i) {
+        size_t len = strlen(optv[longv[i]].name);
+        if(len > maxlen) maxlen = len;
+    }
+    if(maxlen > 64) maxlen = 64;
+
+    int posc = 0;
+    size_t distinct = 0;
+    while(posc < CP__KEY_POSITIONS && distinct < longc) {
+        int best = 0;
+        size_t most = distinct;
+        for(int cand = -(int)maxlen; cand < (int)maxlen; ++cand) {
+            posv[posc] = cand;
+            for(size_t i = 0; i < longc; ++i) {
+                keys[i] = cp__lookupKey(optv[longv[i]].name, posc + 1, posv);
+            }
+            qsort(keys, longc, sizeof(*keys), cp__compareKeys);
+            size_t count = longc > 0;
+            for(size_t i = 1; i < longc; ++i) {
+                count += keys[i] != keys[i-1];
+            }
+            if(count > most) {
+                most = count;
+                best = cand;
+            }
+        }
+        if(most == distinct) break;
+        posv[posc++] = best;
+        distinct = most;
+    }
+    return posc;
+}
+
+// Searches for a multiplier spreading `keys` over `1 << bits` slots with as few collisions as it can find.
+// Collisions only cost a probe, the table stays correct either way.
+static uint64_t cp__pickMultiplier(const uint64_t *keys, size_t longc, int bits, uint8_t *used) {
+    uint64_t state = 0x9E3779B97F4A7C15u;
+    uint64_t best = state;
+    size_t fewest = SIZE_MAX;
+    for(int attempt = 0; attempt < 4096 && fewest > 0; ++attempt) {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        uint64_t mult = state | 1;
+        memset(used, 0, (size_t)1 << bits);
+        size_t collisions = 0;
+        for(size_t i = 0; i < longc; ++i) {
+            size_t slot = (size_t)((keys[i] * mult) >> (64 - bits));
+            collisions += used[slot];
+            used[slot] = 1;
+        }
+        if(collisions < fewest) {
+            fewest = collisions;
+            best = mult;
+        }
+    }
+    return best;
+}
+
+// Emits `<prefix>__findLong`, a hash over the length and the bytes picked by `cp__pickKeyPositions`
+// indexing an open addressed table, followed by a single compare against the candidate's name.
+static bool cp__emitFindLong(FILE *out, const char *prefix, uintmax_t optc, const Cp_Opt optv[]) {
+    uint32_t *longv = (uint32_t*)CP_CALLOC(optc + 1, sizeof(uint32_t));
+    uint64_t *keys = (uint64_t*)CP_CALLOC(optc + 1, sizeof(uint64_t));
+    size_t longc = 0;
+    for(uintmax_t i = 0; longv != NULL && i < optc; ++i) {
+        if(optv[i].name != NULL && optv[i].name[0] != '\0') longv[longc++] = (uint32_t)i;
+    }
+    int bits = 4;
+    while(((size_t)1 << bits) < longc * 4) ++bits;
+    size_t slotc = (size_t)1 << bits;
+    uint8_t *used = (uint8_t*)CP_CALLOC(slotc, 1);
+    uint32_t *slots = (uint32_t*)CP_CALLOC(slotc, sizeof(uint32_t));
+    if(longv == NULL || keys == NULL || used == NULL || slots == NULL) {
+        CP_FREE(longv);
+        CP_FREE(keys);
+        CP_FREE(used);
+        CP_FREE(slots);
+        return false;
+    }
+
+    int posv[CP__KEY_POSITIONS];
+    int posc = cp__pickKeyPositions(optv, longv, longc, keys, posv);
+    for(size_t i = 0; i < longc; ++i) {
+        keys[i] = cp__lookupKey(optv[longv[i]].name, posc, posv);
+    }
+    uint64_t mult = cp__pickMultiplier(keys, longc, bits, used);
+    for(size_t i = 0; i < longc; ++i) {
+        size_t slot = (size_t)((keys[i] * mult) >> (64 - bits));
+        while(slots[slot] != 0) slot = (slot + 1) & (slotc - 1);
+        slots[slot] = longv[i] + 1;
+    }
+    CP_FREE(longv);
+    CP_FREE(keys);
+    CP_FREE(used);
+
+    const char *type = cp__emitIndexType(optc);
+    fprintf(out, "static const char *const %s__names[%ju] = {", prefix, optc + 1);
+    for(uintmax_t i = 0; i < optc; ++i) {
+        fprintf(out, "\n    ");
+        if(optv[i].name != NULL) {
+            cp__emitString(out, optv[i].name, strlen(optv[i].name));
+        } else {
+            fprintf(out, "\"\"");
+        }
+        if(i+1 < optc) fputc(',', out);
+    }
+    fprintf(out, "\n};\n\n");
+    fprintf(out, "static const uint32_t %s__lengths[%ju] = {", prefix, optc + 1);
+    for(uintmax_t i = 0; i < optc; ++i) {
+        fprintf(out, "%s%zu", i % 16 == 0 ? "\n    " : " ", optv[i].name != NULL ? strlen(optv[i].name) : 0);
+        if(i+1 < optc) fputc(',', out);
+    }
+    fprintf(out, "\n};\n\n");
+    fprintf(out, "// Option index plus one, zero for an empty slot.\n");
+    fprintf(out, "static const %s %s__slots[%zu] = {", type, prefix, slotc);
+    for(size_t i = 0; i < slotc; ++i) {
+        fprintf(out, "%s%u", i % 16 == 0 ? "\n    " : " ", slots[i]);
+        if(i+1 < slotc) fputc(',', out);
+    }
+    fprintf(out, "\n};\n\n");
+    CP_FREE(slots);
+
+    fprintf(out, "// Index of the long option named by the `len` bytes at `name`, or -1.\n");
+    fprintf(out, "static int %s__findLong(const char *name, size_t len) {\n", prefix);
+    fprintf(out, "    uint64_t key = len;\n");
+    for(int i = 0; i < posc; ++i) {
+        if(posv[i] >= 0) {
+            fprintf(out, "    key = key << 8 | (len > %d ? (unsigned char)name[%d] : 0);\n", posv[i], posv[i]);
+        } else {
+            int back = -posv[i] - 1;
+            fprintf(out, "    key = key << 8 | (len > %d ? (unsigned char)name[len - %d] : 0);\n", back, back + 1);
+        }
+    }
+    fprintf(out, "    for(size_t slot = (size_t)((key * 0x%016llXu) >> %d);; slot = (slot + 1) & %zu) {\n", (unsigned long long)mult, 64 - bits, slotc - 1);
+    fprintf(out, "        int i = (int)%s__slots[slot] - 1;\n", prefix);
+    fprintf(out, "        if(i < 0) return -1;\n");
+    fprintf(out, "        if(%s__lengths[i] == len && memcmp(name, %s__names[i], len) == 0) return i;\n", prefix, prefix);
+    fprintf(out, "    }\n");
+    fprintf(out, "}\n\n");
+    return true;
+}
+
+// Emits the `case`s of every option of `kind`, returns whether there was any.
+static bool cp__emitKindCases(FILE *out, uintmax_t optc, const Cp_Opt optv[], Cp_Opt_Kind kind, Cp_Opt_Kind other) {
+    bool any = false;
+    for(uintmax_t i = 0; i < optc; ++i) {
+        if(optv[i].kind == kind || optv[i].kind == other) {
+            fprintf(out, "        case %ju:", i);
+            // a backslash would carry the comment over to the next line
+            if(optv[i].name != NULL && strpbrk(optv[i].name, "\\\n\r") == NULL) {
+                fprintf(out, " // %s", optv[i].name);
+            }
+            fprintf(out, "\n");
+            any = true;
+        }
+    }
+    return any;
+}
+
+bool cp_generateParser(FILE *out, const char *prefix, uintmax_t optc, const Cp_Opt optv[]) {
+    if(prefix == NULL || !((prefix[0] >= 'a' && prefix[0] <= 'z') || (prefix[0] >= 'A' && prefix[0] <= 'Z') || prefix[0] == '_')) {
+        return false;
+    }
+    for(const char *c = prefix; *c != '\0'; ++c) {
+        if(!((*c >= 'a' && *c <= 'z') || (*c >= 'A' && *c <= 'Z') || (*c >= '0' && *c <= '9') || *c == '_')) {
+            return false;
+        }
+    }
+    for(uintmax_t i = 0; i < optc; ++i) {
+        for(uintmax_t j = i+1; j < optc; ++j) {
+            if(optv[i].name != NULL && optv[j].name != NULL && cp__streq(optv[i].name, optv[j].name)) {
+                return false;
+            }
+            if(optv[i].short_name != '\0' && optv[i].short_name == optv[j].short_name) {
+                return false;
+            }
+        }
+    }
+    fprintf(out, "// Generated by `cp_generateParser` for a table of %ju options, do not edit.\n", optc);
+    fprintf(out, "// `ctx->optv` must be that same table in the same order, any other goes through `cp_parseUntil`.\n");
+    fprintf(out, "#include \"cli-parser.h\"\n\n");
+    fprintf(out, "int %s_parseUntil(Cp_Ctx *ctx, uintmax_t subcommandc, const char *subcommandv[]);\n", prefix);
+    fprintf(out, "int %s_parse(Cp_Ctx *ctx);\n\n", prefix);
+
+    if(!cp__emitFindLong(out, prefix, optc, optv)) {
+        return false;
+    }
+    fprintf(out, "static const %s %s__shorts[256] = {", cp__emitIndexType(optc), prefix);
+    uintmax_t shorts[256] = {0};
+    for(uintmax_t i = 0; i < optc; ++i) {
+        if(optv[i].short_name != '\0') shorts[(unsigned char)optv[i].short_name] = i + 1;
+    }
+    for(int i = 0; i < 256; ++i) {
+        fprintf(out, "%s%ju", i % 16 == 0 ? "\n    " : " ", shorts[i]);
+        if(i+1 < 256) fputc(',', out);
+    }
+    fprintf(out, "\n};\n\n");
+
+    // 1 for `bool` and 2 for `count` options, which take no value
+    fprintf(out, "static const uint8_t %s__flags[%ju] = {", prefix, optc + 1);
+    for(uintmax_t i = 0; i < optc; ++i) {
+        fprintf(out, "%s%d", i % 16 == 0 ? "\n    " : " ", optv[i].kind == OPTK_BOOL ? 1 : optv[i].kind == OPTK_COUNT ? 2 : 0);
+        if(i+1 < optc) fputc(',', out);
+    }
+    fprintf(out, "\n};\n\n");
+
+    // the rest of the table, to tell whether a context was made for it
+    fprintf(out, "static const uint8_t %s__kinds[%ju] = {", prefix, optc + 1);
+    for(uintmax_t i = 0; i < optc; ++i) {
+        fprintf(out, "%s%d", i % 16 == 0 ? "\n    " : " ", (int)optv[i].kind);
+        if(i+1 < optc) fputc(',', out);
+    }
+    fprintf(out, "\n};\n\n");
+    fprintf(out, "static const uint8_t %s__short_names[%ju] = {", prefix, optc + 1);
+    for(uintmax_t i = 0; i < optc; ++i) {
+        fprintf(out, "%s%d", i % 16 == 0 ? "\n    " : " ", (unsigned char)optv[i].short_name);
+        if(i+1 < optc) fputc(',', out);
+    }
+    fprintf(out, "\n};\n\n");
+    fprintf(out, "// Whether `ctx->optv` is the table this parser was generated from, compared option by option.\n");
+    fprintf(out, "static bool %s__sameTable(const Cp_Ctx *ctx) {\n", prefix);
+    fprintf(out, "    if(ctx->optc != %ju) return false;\n", optc);
+    fprintf(out, "    for(uintmax_t i = 0; i < %ju; ++i) {\n", optc);
+    fprintf(out, "        const Cp_Opt *opt = &ctx->optv[i];\n");
+    fprintf(out, "        if((int)opt->kind != %s__kinds[i] || (unsigned char)opt->short_name != %s__short_names[i]) return false;\n", prefix, prefix);
+    fprintf(out, "        if(strcmp(opt->name != NULL ? opt->name : \"\", %s__names[i]) != 0) return false;\n", prefix);
+    fprintf(out, "    }\n");
+    fprintf(out, "    return true;\n");
+    fprintf(out, "}\n\n");
+
+    // one jump per kind, so a command line mixing options of the same kind keeps taking the same branch
+    fprintf(out, "// Sets option `i` from `value`, which is `ctx->arg` or a part of it.\n");
+    fprintf(out, "static bool %s__setValue(Cp_Ctx *ctx, int i, const char *value) {\n", prefix);
+    fprintf(out, "    const Cp_Opt *opt = &ctx->optv[i];\n");
+    fprintf(out, "    Cp__Num_Status status = CP__NUM_OK;\n");
+    fprintf(out, "    switch(i) {\n");
+    if(cp__emitKindCases(out, optc, optv, OPTK_STRING, OPTK_STRING)) {
+        fprintf(out, "            *(char**)cp__holder(ctx, opt) = (char*)value;\n");
+        fprintf(out, "            cp__markSeen(ctx, opt);\n");
+        fprintf(out, "            return true;\n");
+    }
+    if(cp__emitKindCases(out, optc, optv, OPTK_INT64, OPTK_INT64)) {
+        fprintf(out, "            status = cp__parseInt64(value, strlen(value), (int64_t*)cp__holder(ctx, opt));\n");
+        fprintf(out, "            break;\n");
+    }
+    if(cp__emitKindCases(out, optc, optv, OPTK_UINT64, OPTK_UINT64)) {
+        fprintf(out, "            status = cp__parseUint64(value, strlen(value), (uint64_t*)cp__holder(ctx, opt));\n");
+        fprintf(out, "            break;\n");
+    }
+    if(cp__emitKindCases(out, optc, optv, OPTK_DOUBLE, OPTK_NUMBER)) {
+        fprintf(out, "            status = cp__parseDouble(value, strlen(value), (double*)cp__holder(ctx, opt));\n");
+        fprintf(out, "            break;\n");
+    }
+    fprintf(out, "        default: // lists and enums\n");
+    fprintf(out, "            return cp__setValue(ctx, opt, value);\n");
+    fprintf(out, "    }\n");
+    fprintf(out, "    if(status != CP__NUM_OK) {\n");
+    fprintf(out, "        return cp__fail(ctx, status == CP__NUM_RANGE ? CP_ERR_NUMBER_RANGE : CP_ERR_NOT_A_NUMBER, opt, (int)(value - ctx->arg));\n");
+    fprintf(out, "    }\n");
+    fprintf(out, "    cp__markSeen(ctx, opt);\n");
+    fprintf(out, "    return true;\n");
+    fprintf(out, "}\n\n");
+
+    // same steps as `cp__parseUntil` and `cp__parseArg`, in parts below the 4095 bytes C99 promises a string literal
+    fprintf(out,
+        "int %s_parseUntil(Cp_Ctx *ctx, uintmax_t subcommandc, const char *subcommandv[]) {\n"
+        "    if(ctx->response_files || !%s__sameTable(ctx)) {\n"
+        "        return cp_parseUntil(ctx, subcommandc, subcommandv);\n"
+        "    }\n"
+        "    if(ctx->argument_bits != NULL && ctx->argi < ctx->argc && ctx->argi %% 64 != 0) {\n"
+        "        ctx->argument_bits[ctx->argi / 64] &= ((uint64_t)1 << (ctx->argi %% 64)) - 1;\n"
+        "    }\n"
+        "    for(; ctx->argi < ctx->argc; ++ctx->argi) {\n"
+        "        const char *arg = ctx->argv[ctx->argi];\n"
+        "        ctx->arg = arg;\n"
+        "        if(ctx->argument_bits != NULL && ctx->argi %% 64 == 0) {\n"
+        "            ctx->argument_bits[ctx->argi / 64] = 0;\n"
+        "        }\n"
+        "        if(ctx->pending > 0) {\n"
+        "            int i = ctx->pending - 1;\n"
+        "            ctx->pending = 0;\n"
+        "            if(!%s__setValue(ctx, i, arg)) return -1;\n"
+        "            continue;\n"
+        "        }\n"
+        "\n",
+        prefix, prefix, prefix
+    );
+    fprintf(out,
+        "        if(arg[0] == '-' && arg[1] == '-') {\n"
+        "            const char *name = arg + 2;\n"
+        "            if(name[0] == '\\0') {\n"
+        "                if(!ctx->dashdash_halt) continue;\n"
+        "                for(; ctx->argi < ctx->argc; ++ctx->argi) {\n"
+        "                    ctx->arg = ctx->argv[ctx->argi];\n"
+        "                    if(!cp__storeArgument(ctx, ctx->arg)) return -1;\n"
+        "                }\n"
+        "                return ctx->rules != NULL && !cp_checkRules(ctx, ctx->rules) ? -1 : ctx->argi;\n"
+        "            }\n"
+        "            size_t len = 0;\n"
+        "            while(name[len] != '\\0' && name[len] != '=' && name[len] != ':') ++len;\n"
+        "            int i = %s__findLong(name, len);\n"
+        "            if(i < 0) {\n"
+        "                cp__fail(ctx, CP_ERR_UNKNOWN_LONG, NULL, 2);\n"
+        "                return -1;\n"
+        "            }\n"
+        "            const Cp_Opt *opt = &ctx->optv[i];\n"
+        "            if(%s__flags[i]) {\n"
+        "                if(name[len] != '\\0') {\n"
+        "                    cp__fail(ctx, CP_ERR_BOOL_TAKES_NO_VALUE, opt, (int)(2 + len));\n"
+        "                    return -1;\n"
+        "                }\n"
+        "                if(opt->kind == OPTK_COUNT) ++*(int64_t*)cp__holder(ctx, opt);\n"
+        "                else *(bool*)cp__holder(ctx, opt) = true;\n"
+        "                cp__markSeen(ctx, opt);\n"
+        "            } else if(name[len] != '\\0') {\n"
+        "                if(!%s__setValue(ctx, i, name + len + 1)) return -1;\n"
+        "            } else {\n"
+        "                ctx->pending = i + 1;\n"
+        "            }\n",
+        prefix, prefix, prefix
+    );
+    fprintf(out,
+        "        } else if(arg[0] == '-') {\n"
+        "            const char *cluster = arg + 1;\n"
+        "            for(int j = 0; cluster[j] != '\\0'; ++j) {\n"
+        "                int i = (int)%s__shorts[(unsigned char)cluster[j]] - 1;\n"
+        "                if(i < 0) {\n"
+        "                    cp__fail(ctx, CP_ERR_UNKNOWN_SHORT, NULL, j + 1);\n"
+        "                    return -1;\n"
+        "                }\n"
+        "                const Cp_Opt *opt = &ctx->optv[i];\n"
+        "                char delim = cluster[j+1];\n"
+        "                if(%s__flags[i]) {\n"
+        "                    if(delim == '=' || delim == ':') {\n"
+        "                        cp__fail(ctx, CP_ERR_BOOL_TAKES_NO_VALUE, opt, j + 2);\n"
+        "                        return -1;\n"
+        "                    }\n"
+        "                    if(opt->kind == OPTK_COUNT) ++*(int64_t*)cp__holder(ctx, opt);\n"
+        "                    else *(bool*)cp__holder(ctx, opt) = true;\n"
+        "                    cp__markSeen(ctx, opt);\n"
+        "                    continue;\n"
+        "                }\n"
+        "                if(j > 0) {\n"
+        "                    cp__fail(ctx, CP_ERR_SHORT_NOT_ISOLATED, opt, j + 1);\n"
+        "                    return -1;\n"
+        "                }\n"
+        "                if(delim == '\\0') {\n"
+        "                    ctx->pending = i + 1;\n"
+        "                } else if(delim != '=' && delim != ':') {\n"
+        "                    cp__fail(ctx, CP_ERR_EXPECTED_ASSIGN, opt, j + 2);\n"
+        "                    return -1;\n"
+        "                } else if(!%s__setValue(ctx, i, cluster + j + 2)) {\n"
+        "                    return -1;\n"
+        "                }\n"
+        "                break;\n"
+        "            }\n",
+        prefix, prefix, prefix
+    );
+    fprintf(out,
+        "        } else {\n"
+        "            for(uintmax_t j = 0; j < subcommandc; ++j) {\n"
+        "                if(strcmp(subcommandv[j], arg) == 0) return ctx->rules != NULL && !cp_checkRules(ctx, ctx->rules) ? -1 : ctx->argi;\n"
+        "            }\n"
+        "            if(!cp__storeArgument(ctx, arg)) return -1;\n"
+        "        }\n"
+        "    }\n"
+        "\n"
+        "    if(ctx->pending > 0) {\n"
+        "        --ctx->argi;\n"
+        "        cp__fail(ctx, CP_ERR_MISSING_VALUE, &ctx->optv[ctx->pending - 1], 0);\n"
+        "        ctx->pending = 0;\n"
+        "        return -1;\n"
+        "    }\n"
+        "    return ctx->rules != NULL && !cp_checkRules(ctx, ctx->rules) ? -1 : ctx->argi;\n"
+        "}\n"
+        "\n"
+        "int %s_parse(Cp_Ctx *ctx) {\n"
+        "    return %s_parseUntil(ctx, 0, NULL);\n"
+        "}\n",
+        prefix, prefix
+    );
+    return !ferror(out);
+}
+
+#endif
+
+// internal usage
+// Bytes written by `cp_renderHelp`, counted past `size` so the caller learns the full length.
+// With `grow`, a full `buf` moves to the heap instead, `heap` telling whether it already did.
+typedef struct {
+    char *buf;
+    size_t size;
+    size_t len;
+    bool grow;
+    bool heap;
+} Cp__Out;
+
+static void cp__outBytes(Cp__Out *out, const char *bytes, size_t len) {
+#ifndef CP_NO_MALLOC
+    if(out->grow && out->len + len >= out->size) {
+        size_t size = out->size * 2 > out->len + len + 1 ? out->size * 2 : out->len + len + 1;
+        char *buf = (char*)(out->heap ? CP_REALLOC(out->buf, size) : CP_CALLOC(size, 1));
+        if(buf == NULL) {
+            out->grow = false;
+        } else {
+            if(!out->heap) memcpy(buf, out->buf, out->len);
+            out->buf = buf;
+            out->size = size;
+            out->heap = true;
+        }
+    }
+#endif
+    if(out->len < out->size && len > 0) {
+        size_t room = out->size - out->len;
+        memcpy(out->buf + out->len, bytes, len < room ? len : room);
+    }
+    out->len += len;
+}
+
+static void cp__outSpaces(Cp__Out *out, size_t count) {
+    static const char spaces[] = "                                ";
+    while(count > 0) {
+        size_t chunk = count < sizeof(spaces) - 1 ? count : sizeof(spaces) - 1;
+        cp__outBytes(out, spaces, chunk);
+        count -= chunk;
+    }
+}
+
+// Writes `text` from column `col`, breaking lines at the last space before `width`
+// and starting the next ones at `indent`. Newlines in `text` are kept and a word longer than a line stays whole.
+static void cp__outWrapped(Cp__Out *out, const char *text, size_t col, size_t indent, size_t width) {
+    const char *at = text;
+    // the indent waits for the line to have something, so blank lines stay empty
+    bool indented = true;
+    while(true) {
+        while(*at == ' ') ++at;
+        size_t room = width > col ? width - col : 0;
+        size_t end = 0;
+        size_t cut = 0;
+        while(end < room && at[end] != '\0' && at[end] != '\n') {
+            if(at[end] == ' ') cut = end;
+            ++end;
+        }
+        bool fits = at[end] == '\0' || at[end] == '\n';
+        if(fits || at[end] == ' ') {
+            cut = end;
+        } else if(cut == 0) {
+            cut = strcspn(at, " \n");
+        }
+        size_t len = cut;
+        while(len > 0 && at[len-1] == ' ') --len;
+        if(len > 0 && !indented) {
+            cp__outSpaces(out, indent);
+            indented = true;
+        }
+        cp__outBytes(out, at, len);
+        at += cut;
+        if(*at == '\0') break;
+        if(!fits) {
+            while(*at == ' ') ++at;
+            if(*at == '\0') break;
+        }
+        if(*at == '\n') ++at;
+        cp__outBytes(out, "\n", 1);
+        indented = false;
+        col = indent;
+    }
+    cp__outBytes(out, "\n", 1);
+}
+
+// "One of: a, b, c" from column `indent`, wrapped between the names like `cp__outWrapped`.
+static void cp__outChoices(Cp__Out *out, const Cp_Choice *choices, size_t indent, size_t width) {
+    cp__outBytes(out, "One of: ", 8);
+    size_t col = indent + 8;
+    for(size_t i = 0; choices[i].name != NULL; ++i) {
+        size_t len = strlen(choices[i].name);
+        bool last = choices[i+1].name == NULL;
+        size_t need = len + (last ? 0 : 1);
+        if(i > 0 && col + 1 + need > width) {
+            cp__outBytes(out, "\n", 1);
+            cp__outSpaces(out, indent);
+            col = indent;
+        } else if(i > 0) {
+            cp__outBytes(out, " ", 1);
+            col += 1;
+        }
+        cp__outBytes(out, choices[i].name, len);
+        if(!last) cp__outBytes(out, ",", 1);
+        col += need;
+    }
+    cp__outBytes(out, "\n", 1);
+}
+
+static size_t cp__helpNameLen(const Cp_Ctx *ctx, uintmax_t i) {
+    if(ctx->schema != NULL) {
+        return ctx->schema->longs.lens[i];
+    }
+    return ctx->optv[i].name != NULL ? strlen(ctx->optv[i].name) : 0;
+}
+
+int cp_helpWidth(FILE *file) {
+    const char *columns = getenv("COLUMNS");
+    if(columns != NULL) {
+        int width = atoi(columns);
+        if(width > 0) return width;
+    }
+#ifdef CP__HAS_WINSIZE
+    int fd = file == stdout ? STDOUT_FILENO : file == stderr ? STDERR_FILENO : -1;
+    struct winsize size;
+    if(fd >= 0 && ioctl(fd, TIOCGWINSZ, &size) == 0 && size.ws_col > 0) {
+        return size.ws_col;
+    }
+#else
+    (void)file;
+#endif
+    return 80;
+}
+
+static void cp__renderHelp(const Cp_Ctx *ctx, int width, Cp__Out *out) {
+    // "name, x", the short name alone when there is no long one
+    size_t column = 0;
+    for(uintmax_t i = 0; i < ctx->optc; ++i) {
+        size_t len = cp__helpNameLen(ctx, i);
+        if(ctx->optv[i].short_name != '\0') {
+            len += len > 0 ? 3 : 1;
+        }
+        if(len > column) column = len;
+    }
+    size_t cols = width > 0 ? (size_t)width : 80;
+    // descriptions too far right get lines of their own
+    size_t desc = 2 + column + 3;
+    size_t indent = desc <= cols / 2 ? desc : 8;
+
+    cp__outBytes(out, "OPTIONS:\n", 9);
+    for(uintmax_t i = 0; i < ctx->optc; ++i) {
+        const Cp_Opt *opt = &ctx->optv[i];
+        size_t len = cp__helpNameLen(ctx, i);
+        cp__outSpaces(out, 2);
+        cp__outBytes(out, opt->name, len);
+        if(opt->short_name != '\0') {
+            if(len > 0) {
+                cp__outBytes(out, ", ", 2);
+                len += 2;
+            }
+            cp__outBytes(out, &opt->short_name, 1);
+            len += 1;
+        }
+        bool choices = opt->kind == OPTK_ENUM && opt->choices != NULL && opt->choices[0].name != NULL;
+        if(opt->short_desc == NULL && opt->long_desc == NULL && !choices) {
+            cp__outBytes(out, "\n", 1);
+            continue;
+        }
+        if(indent == desc) {
+            cp__outSpaces(out, column - len);
+            cp__outBytes(out, " : ", 3);
+        } else {
+            cp__outBytes(out, "\n", 1);
+            cp__outSpaces(out, indent);
+        }
+        if(opt->short_desc != NULL) {
+            cp__outWrapped(out, opt->short_desc, indent, indent, cols);
+            if(opt->long_desc != NULL) cp__outSpaces(out, indent);
+        }
+        if(opt->long_desc != NULL) {
+            cp__outWrapped(out, opt->long_desc, indent, indent, cols);
+        }
+        if(choices) {
+            if(opt->short_desc != NULL || opt->long_desc != NULL) cp__outSpaces(out, indent);
+            cp__outChoices(out, opt->choices, indent, cols);
+        }
+    }
+}
+
+size_t cp_renderHelp(const Cp_Ctx *ctx, int width, char *buf, size_t size) {
+    Cp__Out out = {buf, size, 0, false, false};
+    cp__renderHelp(ctx, width, &out);
+    if(size > 0) {
+        buf[out.len < size ? out.len : size - 1] = '\0';
+    }
+    return out.len;
+}
+
+#ifndef CP_NO_MALLOC
+const char *cp_helpText(Cp_Help *help, const Cp_Ctx *ctx, int width, size_t *len) {
+    if(help->text == NULL || help->width != width) {
+        Cp__Out out = {NULL, 0, 0, true, true};
+        cp__renderHelp(ctx, width, &out);
+        cp__outBytes(&out, "", 1);
+        // growing only stops when an allocation failed
+        if(!out.grow) {
+            CP_FREE(out.buf);
+            return NULL;
+        }
+        CP_FREE(help->text);
+        help->text = out.buf;
+        help->len = out.len - 1;
+        help->width = width;
+    }
+    if(len != NULL) *len = help->len;
+    return help->text;
+}
+
+void cp_freeHelp(Cp_Help *help) {
+    CP_FREE(help->text);
+    help->text = NULL;
+    help->len = 0;
+}
+#endif
+
+// internal usage
+static int cp__compareEntries(const void *a, const void *b) {
+    const Cp__Completion_Entry *x = (const Cp__Completion_Entry*)a, *y = (const Cp__Completion_Entry*)b;
+    int order = memcmp(x->name, y->name, x->len < y->len ? x->len : y->len);
+    return order != 0 ? order : (x->len > y->len) - (x->len < y->len);
+}
+
+size_t cp_completionSize(uintmax_t optc, uintmax_t subcommandc) {
+    return sizeof(Cp_CompletionIndex) + (2*optc + subcommandc) * sizeof(Cp__Completion_Entry);
+}
+
+Cp_CompletionIndex *cp_compileCompletionInto(void *storage, size_t size, uintmax_t optc, const Cp_Opt optv[], uintmax_t subcommandc, const char *subcommandv[]) {
+    if(storage == NULL || optc > INT_MAX/4 || subcommandc > INT_MAX/4 || size < cp_completionSize(optc, subcommandc)) {
+        return NULL;
+    }
+    Cp_CompletionIndex *index = (Cp_CompletionIndex*)storage;
+    index->longs = (Cp__Completion_Entry*)(index+1);
+    index->longc = 0;
+    for(uintmax_t i = 0; i < optc; ++i) {
+        if(optv[i].name == NULL) continue;
+        Cp__Completion_Entry entry = {optv[i].name, (uint32_t)strlen(optv[i].name), (uint32_t)i};
+        index->longs[index->longc++] = entry;
+    }
+    index->shorts = index->longs + index->longc;
+    index->shortc = 0;
+    for(uintmax_t i = 0; i < optc; ++i) {
+        if(optv[i].short_name == '\0') continue;
+        Cp__Completion_Entry entry = {&optv[i].short_name, 1, (uint32_t)i};
+        index->shorts[index->shortc++] = entry;
+    }
+    index->subcommands = index->shorts + index->shortc;
+    index->subcommandc = 0;
+    for(uintmax_t i = 0; i < subcommandc; ++i) {
+        if(subcommandv[i] == NULL) continue;
+        Cp__Completion_Entry entry = {subcommandv[i], (uint32_t)strlen(subcommandv[i]), (uint32_t)i};
+        index->subcommands[index->subcommandc++] = entry;
+    }
+    qsort(index->longs, index->longc, sizeof(Cp__Completion_Entry), cp__compareEntries);
+    qsort(index->shorts, index->shortc, sizeof(Cp__Completion_Entry), cp__compareEntries);
+    qsort(index->subcommands, index->subcommandc, sizeof(Cp__Completion_Entry), cp__compareEntries);
+    return index;
+}
+
+#ifndef CP_NO_MALLOC
+Cp_CompletionIndex *cp_compileCompletion(uintmax_t optc, const Cp_Opt optv[], uintmax_t subcommandc, const char *subcommandv[]) {
+    size_t size = cp_completionSize(optc, subcommandc);
+    void *storage = CP_CALLOC(1, size);
+    if(storage == NULL) {
+        return NULL;
+    }
+    Cp_CompletionIndex *index = cp_compileCompletionInto(storage, size, optc, optv, subcommandc, subcommandv);
+    if(index == NULL) {
+        CP_FREE(storage);
+    }
+    return index;
+}
+void cp_freeCompletion(Cp_CompletionIndex *index) {
+    CP_FREE(index);
+}
+#endif
+
+// internal usage
+// Lines go through a buffer on the stack, written out whenever it fills up.
+static void cp__completeLine(Cp__Out *out, FILE *file, const char *dashes, const char *name, size_t len, const char *desc) {
+    size_t desc_len = desc != NULL ? strcspn(desc, "\n") : 0;
+    size_t need = strlen(dashes) + len + 1 + desc_len + 1;
+    if(out->len + need > out->size && out->len > 0) {
+        fwrite(out->buf, 1, out->len, file);
+        out->len = 0;
+    }
+    if(need > out->size) {
+        fputs(dashes, file);
+        fwrite(name, 1, len, file);
+        if(desc_len > 0) {
+            fputc('\t', file);
+            fwrite(desc, 1, desc_len, file);
+        }
+        fputc('\n', file);
+        return;
+    }
+    cp__outBytes(out, dashes, strlen(dashes));
+    cp__outBytes(out, name, len);
+    if(desc_len > 0) {
+        cp__outBytes(out, "\t", 1);
+        cp__outBytes(out, desc, desc_len);
+    }
+    cp__outBytes(out, "\n", 1);
+}
+
+// First of the `count` sorted entries whose name is not below the `len` bytes of `prefix`.
+static uint32_t cp__lowerBound(const Cp__Completion_Entry *entries, uint32_t count, const char *prefix, size_t len) {
+    uint32_t low = 0, high = count;
+    while(low < high) {
+        uint32_t mid = low + (high - low) / 2;
+        const Cp__Completion_Entry *entry = &entries[mid];
+        int order = memcmp(entry->name, prefix, entry->len < len ? entry->len : len);
+        if(order < 0 || (order == 0 && entry->len < len)) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    return low;
+}
+
+static int cp__completeLongs(const Cp_Ctx *ctx, const Cp_CompletionIndex *index, const char *prefix, Cp__Out *out, FILE *file) {
+    size_t len = strlen(prefix);
+    int count = 0;
+    if(index != NULL) {
+        for(uint32_t i = cp__lowerBound(index->longs, index->longc, prefix, len); i < index->longc; ++i) {
+            const Cp__Completion_Entry *entry = &index->longs[i];
+            if(entry->len < len || memcmp(entry->name, prefix, len) != 0) break;
+            cp__completeLine(out, file, "--", entry->name, entry->len, ctx->optv[entry->id].short_desc);
+            ++count;
+        }
+        return count;
+    }
+    for(uintmax_t i = 0; i < ctx->optc; ++i) {
+        const char *name = ctx->optv[i].name;
+        if(name == NULL || strncmp(name, prefix, len) != 0) continue;
+        cp__completeLine(out, file, "--", name, strlen(name), ctx->optv[i].short_desc);
+        ++count;
+    }
+    return count;
+}
+
+// Short options, all of them for an empty `prefix`, otherwise the one named by its single byte.
+static int cp__completeShorts(const Cp_Ctx *ctx, const Cp_CompletionIndex *index, const char *prefix, Cp__Out *out, FILE *file) {
+    size_t len = strlen(prefix);
+    int count = 0;
+    if(len > 1) {
+        return 0;
+    }
+    if(index != NULL) {
+        for(uint32_t i = cp__lowerBound(index->shorts, index->shortc, prefix, len); i < index->shortc; ++i) {
+            const Cp__Completion_Entry *entry = &index->shorts[i];
+            if(len > 0 && entry->name[0] != prefix[0]) break;
+            cp__completeLine(out, file, "-", entry->name, 1, ctx->optv[entry->id].short_desc);
+            ++count;
+        }
+        return count;
+    }
+    for(uintmax_t i = 0; i < ctx->optc; ++i) {
+        const char *short_name = &ctx->optv[i].short_name;
+        if(*short_name == '\0' || (len > 0 && *short_name != prefix[0])) continue;
+        cp__completeLine(out, file, "-", short_name, 1, ctx->optv[i].short_desc);
+        ++count;
+    }
+    return count;
+}
+
+static int cp__completeSubcommands(const Cp_CompletionIndex *index, uintmax_t subcommandc, const char *subcommandv[], const char *prefix, Cp__Out *out, FILE *file) {
+    size_t len = strlen(prefix);
+    int count = 0;
+    if(index != NULL) {
+        for(uint32_t i = cp__lowerBound(index->subcommands, index->subcommandc, prefix, len); i < index->subcommandc; ++i) {
+            const Cp__Completion_Entry *entry = &index->subcommands[i];
+            if(entry->len < len || memcmp(entry->name, prefix, len) != 0) break;
+            cp__completeLine(out, file, "", entry->name, entry->len, NULL);
+            ++count;
+        }
+        return count;
+    }
+    for(uintmax_t i = 0; i < subcommandc; ++i) {
+        if(subcommandv[i] == NULL || strncmp(subcommandv[i], prefix, len) != 0) continue;
+        cp__completeLine(out, file, "", subcommandv[i], strlen(subcommandv[i]), NULL);
+        ++count;
+    }
+    return count;
+}
+
+static bool cp__isSubcommand(const Cp_CompletionIndex *index, uintmax_t subcommandc, const char *subcommandv[], const char *word) {
+    if(index != NULL) {
+        size_t len = strlen(word);
+        uint32_t i = cp__lowerBound(index->subcommands, index->subcommandc, word, len);
+        return i < index->subcommandc && index->subcommands[i].len == len && memcmp(index->subcommands[i].name, word, len) == 0;
+    }
+    for(uintmax_t i = 0; i < subcommandc; ++i) {
+        if(subcommandv[i] != NULL && cp__streq(subcommandv[i], word)) return true;
+    }
+    return false;
+}
+
+int cp_complete(const Cp_Ctx *ctx, const Cp_CompletionIndex *index, uintmax_t subcommandc, const char *subcommandv[], FILE *out) {
+    if(ctx->argc < 2 || !cp__streq(ctx->argv[1], CP_COMPLETE_COMMAND)) {
+        return -1;
+    }
+    const char *word = ctx->argc > 2 ? ctx->argv[ctx->argc - 1] : "";
+    // the words before the last one only tell whether it is a value, same steps as `cp__parseArg`
+    bool value = false;
+    int value_opt = -1;
+    bool stop = false;
+    for(int i = 2; i < ctx->argc - 1 && !stop; ++i) {
+        const char *arg = ctx->argv[i];
+        if(value) {
+            value = false;
+            continue;
+        }
+        Cp__Token token = cp__lexArg(arg);
+        if(token.kind == CP__TOKEN_DASHDASH) {
+            stop = ctx->dashdash_halt;
+        } else if(token.kind == CP__TOKEN_LONG) {
+            size_t len = token.name_len;
+            int opt = -1;
+            if(index != NULL && ctx->schema == NULL) {
+                uint32_t at = cp__lowerBound(index->longs, index->longc, arg + 2, len);
+                if(at < index->longc && index->longs[at].len == len && memcmp(index->longs[at].name, arg + 2, len) == 0) {
+                    opt = (int)index->longs[at].id;
+                }
+            } else {
+                opt = cp__findLongOpt(ctx, arg + 2, len, token.hash);
+            }
+            value = opt >= 0 && !cp__isFlag(ctx->optv[opt].kind) && arg[2 + len] == '\0';
+            value_opt = opt;
+        } else if(token.kind == CP__TOKEN_SHORT) {
+            for(int j = 1; arg[j] != '\0'; ++j) {
+                int opt = -1;
+                if(index != NULL && ctx->schema == NULL) {
+                    uint32_t at = cp__lowerBound(index->shorts, index->shortc, arg + j, 1);
+                    if(at < index->shortc && index->shorts[at].name[0] == arg[j]) {
+                        opt = (int)index->shorts[at].id;
+                    }
+                } else {
+                    opt = cp__findShortOpt(ctx, arg[j]);
+                }
+                if(opt < 0) break;
+                if(!cp__isFlag(ctx->optv[opt].kind)) {
+                    value = arg[j+1] == '\0';
+                    value_opt = opt;
+                    break;
+                }
+            }
+        } else {
+            stop = cp__isSubcommand(index, subcommandc, subcommandv, arg);
+        }
+    }
+
+    char stack[4096];
+    Cp__Out buf = {stack, sizeof(stack), 0, false, false};
+    int count = 0;
+    if(stop) {
+        // nothing to offer
+    } else if(value) {
+        // only the choices of an enum are known ahead of time
+        const Cp_Opt *opt = &ctx->optv[value_opt];
+        size_t word_len = strlen(word);
+        for(size_t i = 0; opt->kind == OPTK_ENUM && opt->choices != NULL && opt->choices[i].name != NULL; ++i) {
+            if(strncmp(opt->choices[i].name, word, word_len) != 0) continue;
+            cp__completeLine(&buf, out, "", opt->choices[i].name, strlen(opt->choices[i].name), NULL);
+            ++count;
+        }
+    } else if(word[0] == '-' && word[1] == '-') {
+        if(strpbrk(word + 2, "=:") == NULL) {
+            count = cp__completeLongs(ctx, index, word + 2, &buf, out);
+        }
+    } else if(word[0] == '-') {
+        count = cp__completeShorts(ctx, index, word + 1, &buf, out);
+        if(word[1] == '\0') {
+            count += cp__completeLongs(ctx, index, "", &buf, out);
+        }
+    } else {
+        count = cp__completeSubcommands(index, subcommandc, subcommandv, word, &buf, out);
+    }
+    fwrite(buf.buf, 1, buf.len, out);
+    return count;
+}
+
+#ifndef CLI_PARSER_CUSTOM_USAGE
+
+void cp_usage(Cp_Ctx *ctx, FILE *file) {
+    char stack[4096];
+    Cp__Out out = {stack, sizeof(stack), 0, true, false};
+    cp__renderHelp(ctx, cp_helpWidth(file), &out);
+    fwrite(out.buf, 1, out.len < out.size ? out.len : out.size, file);
+#ifndef CP_NO_MALLOC
+    if(out.heap) CP_FREE(out.buf);
+#endif
 }
 
 #endif
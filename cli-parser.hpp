@@ -0,0 +1,440 @@
+// C++ front end of cli-parser.h, needing C++20 and the C implementation linked in.
+// Options are described at compile time and bound to members of a struct, e.g.
+//
+//     struct Args {
+//         bool test = false;
+//         std::string_view name;
+//         int64_t repeat = 1;
+//     };
+//     using Cli = cp::Parser<Args,
+//         cp::Opt<&Args::test, "test", 't', "Sick test.">,
+//         cp::Opt<&Args::name, "name", 'n', "Your name.">,
+//         cp::Opt<&Args::repeat, "repeat", 'r', "How many times to greet.">
+//     >;
+//     Args args;
+//     Cli cli(args);
+//     if(cli.parse(argc, argv) == -1) { ... cli.formatError(buf, sizeof(buf)) ... }
+//
+// The command line syntax, the number formats and the error messages are the same as `cp_parse`.
+// The name lookup tables are built by the compiler, where two options sharing a name fail a `static_assert`,
+// and every option parses its value with the routine of its member type instead of switching on a kind.
+// Member types can be `bool`, `std::string_view`, any other integer, `float`, `double`,
+// or a `std::vector` of those last ones for options given many times. Members may belong to a base of the struct.
+// String values point into `argv`. Numbers are converted by the C parsers and errors formatted by
+// `cp_formatErrorInfo`, so this header needs the C implementation: one translation unit has to define
+// CLI_PARSER_IMPLEMENTATION before including it, or link the implementation from elsewhere.
+
+#ifndef CLI_PARSER_HPP
+#define CLI_PARSER_HPP
+
+#if __cplusplus < 202002L
+#error "cli-parser.hpp needs C++20."
+#endif
+
+#include "cli-parser.h"
+
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <span>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <vector>
+
+namespace cp {
+
+// String usable as a template argument, e.g. the "name" of `cp::Opt<&Args::name, "name">`.
+template<size_t N>
+struct Name {
+    char str[N];
+    constexpr Name(const char (&from)[N]) {
+        for(size_t i = 0; i < N; ++i) str[i] = from[i];
+    }
+    constexpr std::string_view view() const { return {str, N - 1}; }
+};
+
+// internal usage
+namespace detail {
+
+// same hash as the C tables, so both agree on what collides
+constexpr uint32_t hash(std::string_view str) {
+    uint32_t h = 2166136261u;
+    for(char c : str) {
+        h = (h ^ (unsigned char)c) * 16777619u;
+    }
+    return h;
+}
+
+// `cp__nameLen` where the compiler sees it: calling it costs a third of an "--name=value" with a number
+inline size_t nameLen(const char *arg, uint32_t &h) {
+    h = 2166136261u;
+    size_t len = 0;
+    for(; arg[len] != '\0' && arg[len] != '=' && arg[len] != ':'; ++len) {
+        h = (h ^ (unsigned char)arg[len]) * 16777619u;
+    }
+    return len;
+}
+
+template<class M>
+struct Member;
+template<class T, class V>
+struct Member<V T::*> {
+    using Struct = T;
+    using Value = V;
+};
+
+inline Cp_Err_Code numberError(Cp__Num_Status status) {
+    return status == CP__NUM_OK ? CP_ERR_NONE : status == CP__NUM_RANGE ? CP_ERR_NUMBER_RANGE : CP_ERR_NOT_A_NUMBER;
+}
+
+// Converted as 64 bits by the C parsers, then checked against the range of `I`.
+template<class I>
+Cp_Err_Code parseInteger(std::string_view str, I &out) {
+    Cp__Num_Status status;
+    if constexpr(std::is_signed_v<I>) {
+        int64_t wide;
+        status = cp__parseInt64(str.data(), str.size(), &wide);
+        if(status == CP__NUM_OK && (wide < std::numeric_limits<I>::min() || wide > std::numeric_limits<I>::max())) {
+            status = CP__NUM_RANGE;
+        }
+        if(status == CP__NUM_OK) out = (I)wide;
+    } else {
+        uint64_t wide;
+        status = cp__parseUint64(str.data(), str.size(), &wide);
+        if(status == CP__NUM_OK && wide > std::numeric_limits<I>::max()) {
+            status = CP__NUM_RANGE;
+        }
+        if(status == CP__NUM_OK) out = (I)wide;
+    }
+    return numberError(status);
+}
+
+template<class F>
+Cp_Err_Code parseFloat(std::string_view str, F &out) {
+    double wide;
+    Cp__Num_Status status = cp__parseDouble(str.data(), str.size(), &wide);
+    // too small values round to 0 like in the C parser, only too big finite ones are out of range
+    if(status == CP__NUM_OK && std::isfinite(wide) && (wide > std::numeric_limits<F>::max() || wide < -std::numeric_limits<F>::max())) {
+        status = CP__NUM_RANGE;
+    }
+    if(status == CP__NUM_OK) out = (F)wide;
+    return numberError(status);
+}
+
+// Parse routine of each member type, `kind` is what errors call it.
+template<class V, class Enable = void>
+struct Value;
+template<>
+struct Value<bool> {
+    static constexpr const char *kind = "bool";
+};
+template<>
+struct Value<std::string_view> {
+    static constexpr const char *kind = "string";
+    static Cp_Err_Code set(std::string_view &out, std::string_view str) {
+        out = str;
+        return CP_ERR_NONE;
+    }
+};
+template<class I>
+struct Value<I, std::enable_if_t<std::is_integral_v<I> && !std::is_same_v<I, bool>>> {
+    static constexpr const char *kind = sizeof(I) == 1 ? (std::is_signed_v<I> ? "int8" : "uint8")
+        : sizeof(I) == 2 ? (std::is_signed_v<I> ? "int16" : "uint16")
+        : sizeof(I) == 4 ? (std::is_signed_v<I> ? "int32" : "uint32")
+        : (std::is_signed_v<I> ? "int64" : "uint64");
+    static Cp_Err_Code set(I &out, std::string_view str) {
+        return parseInteger(str, out);
+    }
+};
+template<class F>
+struct Value<F, std::enable_if_t<std::is_floating_point_v<F>>> {
+    static constexpr const char *kind = std::is_same_v<F, float> ? "float" : "double";
+    static Cp_Err_Code set(F &out, std::string_view str) {
+        return parseFloat(str, out);
+    }
+};
+template<class V>
+struct Value<std::vector<V>> {
+    static constexpr const char *kind = Value<V>::kind;
+    static Cp_Err_Code set(std::vector<V> &out, std::string_view str) {
+        V item;
+        Cp_Err_Code code = Value<V>::set(item, str);
+        if(code == CP_ERR_NONE) {
+            out.push_back(item);
+        }
+        return code;
+    }
+};
+
+} // namespace detail
+
+// Binds the member `Member` to the option "--`Long`", and "-`Short`" unless that is '\0'.
+// An empty `Long` leaves the option with only its short name.
+template<auto Member, Name Long, char Short = '\0', Name Desc = "">
+struct Opt {
+    using Struct = typename detail::Member<decltype(Member)>::Struct;
+    using Value = typename detail::Member<decltype(Member)>::Value;
+    static constexpr auto pointer = Member;
+    static constexpr std::string_view name = Long.view();
+    static constexpr char short_name = Short;
+    static constexpr std::string_view short_desc = Desc.view();
+    static constexpr bool flag = std::is_same_v<Value, bool>;
+};
+
+template<class T, class... Opts>
+class Parser {
+public:
+    static constexpr size_t optc = sizeof...(Opts);
+    static_assert(optc > 0 && optc < UINT16_MAX, "a parser takes between 1 and 65534 options.");
+    static_assert((std::is_base_of_v<typename Opts::Struct, T> && ...), "every option must point to a member of the parsed struct or of one of its bases.");
+
+    // indexed like `Opts`
+    static constexpr std::array<std::string_view, optc> names = {Opts::name...};
+    static constexpr std::array<char, optc> short_names = {Opts::short_name...};
+    static constexpr std::array<std::string_view, optc> short_descs = {Opts::short_desc...};
+
+    // Positional arguments go to `argumentv` until it is full, after which they are an error.
+    // With an empty `argumentv` they are only counted.
+    explicit Parser(T &values, std::span<std::string_view> argumentv = {})
+        : values(&values), argumentv(argumentv) {}
+
+    T *values;
+    std::span<std::string_view> argumentv;
+    size_t argumentc = 0;
+    // Stops at "--" and treats it and everything after it as positional arguments.
+    bool dashdash_halt = false;
+    Cp_Error err = {};
+
+    // Same as `cp_parse`: returns `argc`, or -1 with the reason in `err`.
+    int parse(int argc, char *argv[]) {
+        argumentc = 0;
+        err = {};
+        err.opt = -1;
+        err.other = -1;
+        int pending = 0;
+        for(int argi = 0; argi < argc; ++argi) {
+            const char *arg = argv[argi];
+            if(pending > 0) {
+                if(!set(pending - 1, arg, argi, arg)) return -1;
+                pending = 0;
+                continue;
+            }
+            if(arg[0] == '-' && arg[1] == '-') {
+                const char *name = arg + 2;
+                if(name[0] == '\0') {
+                    if(!dashdash_halt) continue;
+                    for(; argi < argc; ++argi) {
+                        if(!storeArgument(argv[argi], argi)) return -1;
+                    }
+                    return argc;
+                }
+                uint32_t h;
+                size_t len = detail::nameLen(name, h);
+                int i = findLong(std::string_view(name, len), h);
+                if(i < 0) {
+                    return fail(CP_ERR_UNKNOWN_LONG, argi, arg, -1, 2);
+                }
+                if(flags[i]) {
+                    if(name[len] != '\0') {
+                        return fail(CP_ERR_BOOL_TAKES_NO_VALUE, argi, arg, i, (int)(2 + len));
+                    }
+                    setFlag(i);
+                } else if(name[len] != '\0') {
+                    if(!set(i, name + len + 1, argi, arg)) return -1;
+                } else {
+                    pending = i + 1;
+                }
+            } else if(arg[0] == '-') {
+                // walked once while matching, a flag followed by a delimiter fails on its own
+                const char *cluster = arg + 1;
+                for(int j = 0; cluster[j] != '\0'; ++j) {
+                    int i = (int)shorts[(unsigned char)cluster[j]] - 1;
+                    if(i < 0) {
+                        return fail(CP_ERR_UNKNOWN_SHORT, argi, arg, -1, j + 1);
+                    }
+                    char delim = cluster[j+1];
+                    if(flags[i]) {
+                        if(delim == '=' || delim == ':') {
+                            return fail(CP_ERR_BOOL_TAKES_NO_VALUE, argi, arg, i, j + 2);
+                        }
+                        setFlag(i);
+                        continue;
+                    }
+                    if(j > 0) {
+                        return fail(CP_ERR_SHORT_NOT_ISOLATED, argi, arg, i, j + 1);
+                    }
+                    if(delim == '\0') {
+                        pending = i + 1;
+                    } else if(delim != '=' && delim != ':') {
+                        return fail(CP_ERR_EXPECTED_ASSIGN, argi, arg, i, j + 2);
+                    } else if(!set(i, cluster + j + 2, argi, arg)) {
+                        return -1;
+                    }
+                    // the rest of the arg was the value
+                    break;
+                }
+            } else if(!storeArgument(arg, argi)) {
+                return -1;
+            }
+        }
+        if(pending > 0) {
+            return fail(CP_ERR_MISSING_VALUE, argc - 1, argv[argc - 1], pending - 1, 0);
+        }
+        return argc;
+    }
+
+    // Same messages as `cp_formatError`, which renders them too.
+    int formatError(char *buf, size_t len) const {
+        Cp_Error_Info info = {};
+        if(err.opt >= 0) {
+            // the names are kept with their NUL by `cp::Name`
+            info.opt_name = names[err.opt].data();
+            info.opt_kind = kinds[err.opt];
+        }
+        info.argumentcap = (int)argumentv.size();
+        return cp_formatErrorInfo(&err, &info, buf, len);
+    }
+
+private:
+    // ---- tables built by the compiler ----
+
+    static constexpr size_t slotc = [] {
+        size_t count = 1;
+        while(count < optc * 2) count *= 2;
+        return count;
+    }();
+
+    // `index+1` of the option in each slot, 0 when empty, probed linearly like `Cp__NameTable`
+    static constexpr std::array<uint16_t, slotc> longs = [] {
+        std::array<uint16_t, slotc> slots = {};
+        for(size_t i = 0; i < optc; ++i) {
+            if(names[i].empty()) continue;
+            size_t slot = detail::hash(names[i]) & (slotc - 1);
+            while(slots[slot] != 0) slot = (slot + 1) & (slotc - 1);
+            slots[slot] = (uint16_t)(i + 1);
+        }
+        return slots;
+    }();
+
+    static constexpr std::array<uint16_t, 256> shorts = [] {
+        std::array<uint16_t, 256> owners = {};
+        for(size_t i = 0; i < optc; ++i) {
+            if(short_names[i] != '\0') owners[(unsigned char)short_names[i]] = (uint16_t)(i + 1);
+        }
+        return owners;
+    }();
+
+    static constexpr bool unique_names = [] {
+        for(size_t i = 0; i < optc; ++i) {
+            for(size_t j = i + 1; j < optc; ++j) {
+                if(!names[i].empty() && names[i] == names[j]) return false;
+            }
+        }
+        return true;
+    }();
+    static constexpr bool unique_short_names = [] {
+        for(size_t i = 0; i < optc; ++i) {
+            for(size_t j = i + 1; j < optc; ++j) {
+                if(short_names[i] != '\0' && short_names[i] == short_names[j]) return false;
+            }
+        }
+        return true;
+    }();
+    static_assert(unique_names, "two options share the same long name.");
+    static_assert(unique_short_names, "two options share the same short name.");
+
+    // ---- dispatch by member type ----
+    // Options are grouped by the type of their member, and each group is stood for by its first option.
+    // Setting a value picks the group, then finds the member in a table of that type only,
+    // so a command line mixing many options of the same type keeps taking the same branch.
+
+    template<class O>
+    static constexpr uint16_t groupOf() {
+        constexpr bool same[] = {std::is_same_v<typename O::Value, typename Opts::Value>...};
+        uint16_t i = 0;
+        while(!same[i]) ++i;
+        return i;
+    }
+    template<class V, class O>
+    static constexpr V T::*memberOf() {
+        if constexpr(std::is_same_v<typename O::Value, V>) {
+            return O::pointer;
+        } else {
+            return nullptr;
+        }
+    }
+
+    static constexpr std::array<uint16_t, optc> groups = {groupOf<Opts>()...};
+    // the member of every option of type `V`, null for the others
+    template<class V>
+    static constexpr std::array<V T::*, optc> members = {memberOf<V, Opts>()...};
+    static constexpr std::array<bool, optc> flags = {Opts::flag...};
+    static constexpr std::array<const char *, optc> kinds = {detail::Value<typename Opts::Value>::kind...};
+
+    template<size_t G>
+    bool setAs(int i, const char *value, int argi, const char *arg) {
+        using V = typename std::tuple_element_t<G, std::tuple<Opts...>>::Value;
+        if constexpr(!std::is_same_v<V, bool>) {
+            Cp_Err_Code code = detail::Value<V>::set(values->*members<V>[i], std::string_view(value));
+            if(code != CP_ERR_NONE) {
+                fail(code, argi, arg, i, (int)(value - arg));
+                return false;
+            }
+        }
+        return true;
+    }
+    template<size_t... G>
+    bool setGroup(std::index_sequence<G...>, int i, const char *value, int argi, const char *arg) {
+        bool ok = true;
+        // only the first option of each group survives `groups[G] == G`, which is known at compile time
+        ((groups[G] == G && groups[i] == G && (ok = setAs<G>(i, value, argi, arg), true)) || ...);
+        return ok;
+    }
+    bool set(int i, const char *value, int argi, const char *arg) {
+        return setGroup(std::make_index_sequence<optc>(), i, value, argi, arg);
+    }
+    // flags are set by just being present, `flags[i]` must be true
+    void setFlag(int i) {
+        values->*members<bool>[i] = true;
+    }
+
+    static int findLong(std::string_view name, uint32_t h) {
+        size_t slot = h & (slotc - 1);
+        uint16_t entry;
+        while((entry = longs[slot]) != 0) {
+            if(names[entry - 1] == name) return entry - 1;
+            slot = (slot + 1) & (slotc - 1);
+        }
+        return -1;
+    }
+
+    bool storeArgument(const char *arg, int argi) {
+        if(argumentc < argumentv.size()) {
+            argumentv[argumentc++] = arg;
+            return true;
+        }
+        if(!argumentv.empty()) {
+            fail(CP_ERR_TOO_MANY_ARGUMENTS, argi, arg, -1, 0);
+            return false;
+        }
+        ++argumentc;
+        return true;
+    }
+
+    // Records the error and returns -1, so failure paths can `return fail(...)`.
+    int fail(Cp_Err_Code code, int argi, const char *arg, int opt, int offset) {
+        err.code = code;
+        err.argi = argi;
+        err.opt = opt;
+        err.other = -1;
+        err.offset = offset;
+        err.arg = arg;
+        return -1;
+    }
+};
+
+} // namespace cp
+
+#endif // CLI_PARSER_HPP
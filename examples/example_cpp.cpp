@@ -0,0 +1,63 @@
+#define CLI_PARSER_IMPLEMENTATION
+#include "cli-parser.hpp"
+
+#include <cstdio>
+
+// Same options as example_simple.c, declared at compile time.
+// E.g. `./example_cpp -t --name bob -r 2 -g Hello -g Howdy file.c`
+
+struct Args {
+    bool help = false;
+    bool test = false;
+    std::string_view name;
+    double number = 0;
+    int64_t repeat = 1;
+    std::vector<std::string_view> greetings;
+};
+
+using Cli = cp::Parser<Args,
+    cp::Opt<&Args::help, "help", 'h', "Prints this help message.">,
+    cp::Opt<&Args::test, "test", 't', "Sick test.">,
+    cp::Opt<&Args::name, "name", 'n', "Your name.">,
+    cp::Opt<&Args::number, "number", 'N', "Number to print.">,
+    cp::Opt<&Args::repeat, "repeat", 'r', "How many times to greet. Accepts hex (0x) and binary (0b) too.">,
+    cp::Opt<&Args::greetings, "greeting", 'g', "Greeting to use instead of \"Hi\", can be given many times.">
+>;
+
+int main(int argc, char *argv[]) {
+    Args args;
+    std::string_view arguments[64];
+    Cli cli(args, arguments);
+    if(cli.parse(argc, argv) == -1) {
+        char err[256];
+        cli.formatError(err, sizeof(err));
+        printf("ERROR: %s\n", err);
+        return 1;
+    }
+
+    if(args.help) {
+        printf("OPTIONS:\n");
+        for(size_t i = 0; i < Cli::optc; ++i) {
+            printf("  --%-10s -%c : %s\n", Cli::names[i].data(), Cli::short_names[i], Cli::short_descs[i].data());
+        }
+        return 0;
+    }
+    if(args.test) {
+        printf("This is a very sick test\n");
+    }
+    if(args.number != 0) {
+        printf("Number: %lf\n", args.number);
+    }
+    for(int64_t i = 0; !args.name.empty() && i < args.repeat; ++i) {
+        if(args.greetings.empty()) {
+            printf("Hi, %.*s!\n", (int)args.name.size(), args.name.data());
+        }
+        for(std::string_view greeting : args.greetings) {
+            printf("%.*s, %.*s!\n", (int)greeting.size(), greeting.data(), (int)args.name.size(), args.name.data());
+        }
+    }
+    for(size_t i = 0; i < cli.argumentc; ++i) {
+        printf("Argument[%zu] = %.*s\n", i, (int)arguments[i].size(), arguments[i].data());
+    }
+    return 0;
+}
@@ -0,0 +1,101 @@
+// Parses the same command lines over and over with a context and schema owned by the caller,
+// and fails if the library touched the heap while doing so.
+// Build it without AddressSanitizer, which brings its own allocator and would hide the interposer below.
+#define CP_NO_MALLOC
+#define CLI_PARSER_IMPLEMENTATION
+#include "cli-parser.h"
+
+// glibc's real allocator, every allocation in the program goes through the wrappers below
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t count, size_t size);
+extern void *__libc_realloc(void *ptr, size_t size);
+extern void __libc_free(void *ptr);
+
+static bool counting = false;
+static long allocations = 0;
+
+void *malloc(size_t size) {
+    if(counting) ++allocations;
+    return __libc_malloc(size);
+}
+void *calloc(size_t count, size_t size) {
+    if(counting) ++allocations;
+    return __libc_calloc(count, size);
+}
+void *realloc(void *ptr, size_t size) {
+    if(counting) ++allocations;
+    return __libc_realloc(ptr, size);
+}
+void free(void *ptr) {
+    __libc_free(ptr);
+}
+
+int main(int argc, char *argv[]) {
+    bool verbose = false;
+    char *output = NULL;
+    int64_t jobs = 0;
+    double ratio = 0;
+    // a list filling an array of ours, it can't grow without malloc
+    char *define_items[4];
+    Cp_List defines = {define_items, 0, 4, true};
+    Cp_Opt opts[] = {
+        {&verbose, OPTK_BOOL, "verbose", 'v', "Talks more."},
+        {&output, OPTK_STRING, "output", 'o', "Where to write."},
+        {&jobs, OPTK_INT64, "jobs", 'j', "How many jobs to run."},
+        {&ratio, OPTK_DOUBLE, "ratio", 'r', "Some ratio."},
+        {&defines, OPTK_STRING_LIST, "define", 'D', "Defines a macro, up to 4 times."}
+    };
+    const uintmax_t optc = sizeof(opts)/sizeof(*opts);
+
+    // the schema lives in static storage, sized generously for this table
+    static uint64_t schema_storage[512];
+    if(cp_schemaSize(optc) > sizeof(schema_storage)) {
+        printf("ERROR: Schema storage is too small.\n");
+        return 1;
+    }
+    const Cp_Schema *schema = cp_compileOptsInto(schema_storage, sizeof(schema_storage), optc, opts);
+    if(schema == NULL) {
+        printf("ERROR: Could not compile the options.\n");
+        return 1;
+    }
+
+    char *lines[][8] = {
+        {"app", "-v", "--output=out.txt", "--jobs", "0x10", "file.c"},
+        {"app", "-o", "a.out", "-j=4", "--ratio:0.5", "-D", "A=1", "a.c"},
+        {"app", "--jobs=nope"},
+        {"app", "--unknown"},
+        {"app", "-D=a", "-D", "b", "--define=c", "-D:d", "-D=e"},
+    };
+    const int linec = sizeof(lines)/sizeof(*lines);
+
+    char *argumentv[8];
+    Cp_Ctx ctx;
+    if(!cp_initCtx(&ctx, 1, lines[0], optc, opts, 8, argumentv)) {
+        return 1;
+    }
+    ctx.schema = schema;
+
+    int failures = 0;
+    counting = true;
+    for(int round = 0; round < 10000; ++round) {
+        for(int i = 0; i < linec; ++i) {
+            int line_argc = 0;
+            while(line_argc < 8 && lines[i][line_argc] != NULL) ++line_argc;
+            cp_resetCtx(&ctx, line_argc, lines[i]);
+            defines.count = 0;
+            if(cp_parse(&ctx) == -1) {
+                ++failures;
+            }
+        }
+    }
+    counting = false;
+
+    printf("Parsed %d command lines, %d of them failed as expected.\n", 10000 * linec, failures);
+    printf("Last values: verbose=%d output=%s jobs=%lld ratio=%g defines=%zu\n", verbose, output, (long long)jobs, ratio, defines.count);
+    if(allocations != 0) {
+        printf("ERROR: Parsing allocated %ld time(s).\n", allocations);
+        return 1;
+    }
+    printf("No allocations while parsing.\n");
+    return 0;
+}
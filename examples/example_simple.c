@@ -3,54 +3,61 @@
 
 #include <stdio.h>
 
-void usage(Cp_Ctx *ctx, FILE *file) {
-    int maxlen = 0;
-    for (int i = 0; i < ctx->optc; ++i) {
-        int len = strlen(ctx->optv[i].name);
-        if (ctx->optv[i].short_name != '\0') {
-            len += 2; // for ", X"
-        }
-        if (len > maxlen) maxlen = len;
-    }
-
-    printf("OPTIONS:\n");
-    for(int i = 0; i < ctx->optc; ++i) {
-        Cp_Opt opt = ctx->optv[i];
-        printf("  %s", opt.name);
-        if(opt.short_name != '\0') {
-            printf(", %c", opt.short_name);
-        }
-        int printed_len = (opt.short_name != '\0')
-            ? (int)strlen(opt.name) + 3  // "name, x"
-            : (int)strlen(opt.name);
-        int padding = maxlen - printed_len + 2;
-        printf("%-*s", padding, "\0");
-        printf(" : %s\n", opt.short_desc);
-    }
-}
-
 int main(int argc, char *argv[]) {
-    bool help;
-    bool test;
+    bool help = false;
+    bool test = false;
     char *file = NULL;
     char *name = NULL;
     double numb = CP_NUMBER_INVALID;
+    int64_t repeat = 1;
+    Cp_List greetings = {0};
+    char *config = NULL;
+    int64_t verbose = 0;
     Cp_Opt opts[] = {
         {&help, OPTK_BOOL, "help", 'h', "Prints this help message. Upon doing so, exits the program successfully."},
         {&test, OPTK_BOOL, "test", 't', "Sick test."},
-        {&file, OPTK_STRING, "file", 0, "File to print.", "File which the program will print, whilst not removing its contents. Can be useful as a replacement for `cat`. Upon printing, exits the program successfully."},
-        {&name, OPTK_STRING, "name", 'n', "Your name.", "Prints your name to the terminal screen."},
-        {&numb, OPTK_NUMBER, "number", 'N', "Number to print."}
+        {&file, OPTK_STRING, "file", 0, "File to print.", .long_desc = "File which the program will print, whilst not removing its contents. Can be useful as a replacement for `cat`. Upon printing, exits the program successfully."},
+        {&name, OPTK_STRING, "name", 'n', "Your name.", .long_desc = "Prints your name to the terminal screen.", .env = "EXAMPLE_NAME"},
+        {&numb, OPTK_NUMBER, "number", 'N', "Number to print."},
+        {&repeat, OPTK_INT64, "repeat", 'r', "How many times to greet. Accepts hex (0x) and binary (0b) too.", .env = "EXAMPLE_REPEAT"},
+        {&greetings, OPTK_STRING_LIST, "greeting", 'g', "Greeting to use instead of \"Hi\", can be given many times."},
+        {&config, OPTK_STRING, "config", 'c', "File of \"key = value\" lines for the options not given otherwise."},
+        {&verbose, OPTK_COUNT, "verbose", 'v', "Prints more, up to -vvv."}
+    };
+    // indices in `opts`
+    static const int help_or_file[] = {0, 2};
+    static const int greeting_needs_name[] = {6, 3};
+    static const int verbosity[] = {8};
+    const Cp_Rule rulev[] = {
+        {CP_RULE_EXCLUSIVE, 2, help_or_file},
+        {CP_RULE_REQUIRES, 2, greeting_needs_name},
+        {CP_RULE_AT_MOST, 1, verbosity, 3}
     };
+    uint32_t counts[sizeof(opts)/sizeof(*opts)] = {0};
     
-    char **argumentv = alloca( argc * sizeof(char*));
-    Cp_Ctx *ctx = cp_newCtx(argc, argv, sizeof(opts)/sizeof(*opts), opts, argc, argumentv);
+    // one bit per argument instead of a copy of every pointer
+    uint64_t *argument_bits = alloca(CP_ARGUMENT_WORDS(argc) * sizeof(uint64_t));
+    Cp_Ctx *ctx = cp_newCtx(argc, argv, sizeof(opts)/sizeof(*opts), opts, 0, NULL);
     if(ctx == NULL) {
         return 1;
     }
+    ctx->argument_bits = argument_bits;
+    ctx->counts = counts;
+    Cp_Rules *rules = cp_compileRules(sizeof(opts)/sizeof(*opts), sizeof(rulev)/sizeof(*rulev), rulev);
+    // `./example_simple @args.txt` reads more arguments from "args.txt"
+    ctx->response_files = true;
     
-    if(cp_parse(ctx) == -1) {
-        printf("ERROR: %s\n", ctx->err);
+    // options missing from the command line can come from EXAMPLE_NAME and EXAMPLE_REPEAT, then from the config file,
+    // and the rules are checked once all of them had their say
+    if(
+        cp_parse(ctx) == -1 || !cp_applyEnv(ctx, NULL) || (config != NULL && !cp_parseConfigFile(ctx, config)) ||
+        !cp_checkRules(ctx, rules)
+    ) {
+        char err[256];
+        cp_formatError(ctx, err, sizeof(err));
+        printf("ERROR: %s\n", err);
+        cp_freeList(&greetings);
+        cp_freeRules(rules);
         cp_freeCtx(ctx);
         return 1;
     }
@@ -61,21 +68,34 @@ int main(int argc, char *argv[]) {
     if(CpNumberIsValid(numb)) {
         printf("Number: %lf\n", numb);
     }
+    if(verbose > 0) {
+        printf("Verbosity: %lld\n", (long long)verbose);
+    }
     if(help) {
-        usage(ctx, stdout);
+        cp_usage(ctx, stdout);
+        cp_freeList(&greetings);
+        cp_freeRules(rules);
         cp_freeCtx(ctx);
         return 0;
     }
-    if(name != NULL) {
-        printf("Hi, %s!\n", name);
+    for(int64_t i = 0; name != NULL && i < repeat; ++i) {
+        if(greetings.count == 0) {
+            printf("Hi, %s!\n", name);
+        }
+        for(size_t j = 0; j < greetings.count; ++j) {
+            printf("%s, %s!\n", ((char**)greetings.items)[j], name);
+        }
     }
     if(file != NULL) {
         printf("File name: %s\n", file);
     }
-    for(int i = 0; i < ctx->argumentc; ++i) {
-        printf("Argument[%d] = %s\n", i, ctx->argumentv[i]);
+    int argumentc = 0;
+    for(int i = cp_nextArgument(ctx, 0); i >= 0; i = cp_nextArgument(ctx, i+1)) {
+        printf("Argument[%d] = %s\n", argumentc++, ctx->argv[i]);
     }
 
+    cp_freeList(&greetings);
+    cp_freeRules(rules);
     cp_freeCtx(ctx);
     return 0;
 }
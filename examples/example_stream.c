@@ -0,0 +1,89 @@
+#define CLI_PARSER_IMPLEMENTATION
+#include "cli-parser.h"
+
+#include <stdio.h>
+
+// Reads NUL-separated arguments from stdin, the way `find -print0` or `xargs -0` produce them,
+// and parses them as they come in without ever holding an argv.
+// E.g. `printf '%s\0' --name bob -t file1.c file2.c | ./example_stream`
+
+static bool feed(Cp_Ctx *ctx, char *token, size_t len, long *argumentc) {
+    int result = cp_feed(ctx, token, len);
+    if(result == -1) {
+        char err[256];
+        cp_formatError(ctx, err, sizeof(err));
+        printf("ERROR: %s\n", err);
+        return false;
+    }
+    if(result == 1) {
+        printf("Argument[%ld] = %s\n", (*argumentc)++, token);
+    }
+    return true;
+}
+
+int main(void) {
+    bool test = false;
+    char *name = NULL;
+    int64_t repeat = 1;
+    Cp_Opt opts[] = {
+        {&test, OPTK_BOOL, "test", 't', "Sick test."},
+        {&name, OPTK_STRING, "name", 'n', "Your name."},
+        {&repeat, OPTK_INT64, "repeat", 'r', "How many times to greet."}
+    };
+
+    Cp_Ctx ctx;
+    if(!cp_initCtx(&ctx, 0, NULL, sizeof(opts)/sizeof(*opts), opts, 0, NULL)) {
+        return 1;
+    }
+    ctx.dashdash_halt = true;
+
+    // string values point into `buf`, which is reused, so the name is copied out right away
+    static char buf[1 << 16];
+    char name_copy[256] = {0};
+    size_t have = 0;
+    long argumentc = 0;
+    while(true) {
+        size_t got = fread(buf + have, 1, sizeof(buf) - 1 - have, stdin);
+        have += got;
+
+        size_t start = 0;
+        for(size_t i = 0; i < have; ++i) {
+            if(buf[i] != '\0') continue;
+            if(!feed(&ctx, buf + start, i - start, &argumentc)) return 1;
+            start = i + 1;
+        }
+        if(got == 0) {
+            if(start < have) {
+                buf[have] = '\0';
+                if(!feed(&ctx, buf + start, have - start, &argumentc)) return 1;
+            }
+            break;
+        }
+        if(name >= buf && name < buf + sizeof(buf)) {
+            snprintf(name_copy, sizeof(name_copy), "%s", name);
+            name = name_copy;
+        }
+
+        memmove(buf, buf + start, have - start);
+        have -= start;
+        if(have == sizeof(buf) - 1) {
+            printf("ERROR: Argument longer than %zu bytes.\n", sizeof(buf) - 1);
+            return 1;
+        }
+    }
+    if(!cp_finish(&ctx)) {
+        char err[256];
+        cp_formatError(&ctx, err, sizeof(err));
+        printf("ERROR: %s\n", err);
+        return 1;
+    }
+
+    if(test) {
+        printf("This is a very sick test\n");
+    }
+    for(int64_t i = 0; name != NULL && i < repeat; ++i) {
+        printf("Hi, %s!\n", name);
+    }
+    printf("%d arguments streamed.\n", ctx.argi);
+    return 0;
+}
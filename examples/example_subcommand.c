@@ -1,70 +1,15 @@
 #define CLI_PARSER_IMPLEMENTATION
 #include "cli-parser.h"
 
-void usage(Cp_Ctx *ctx, FILE *file) {
-    int maxlen = 0;
-    for (int i = 0; i < ctx->optc; ++i) {
-        int len = strlen(ctx->optv[i].name);
-        if (ctx->optv[i].short_name != '\0') {
-            len += 2; // for ", X"
-        }
-        if (len > maxlen) maxlen = len;
-    }
-
-    printf("OPTIONS:\n");
-    for(int i = 0; i < ctx->optc; ++i) {
-        Cp_Opt opt = ctx->optv[i];
-        printf("  %s", opt.name);
-        if(opt.short_name != '\0') {
-            printf(", %c", opt.short_name);
-        }
-        int printed_len = (opt.short_name != '\0')
-            ? (int)strlen(opt.name) + 3  // "name, x"
-            : (int)strlen(opt.name);
-        int padding = maxlen - printed_len + 2;
-        printf("%-*s", padding, "\0");
-        printf(" : %s\n", opt.short_desc);
-    }
-}
-
-int main(int argc, char *argv[]) {
-    bool test;
-    char *file = NULL;
-    char *name = NULL;
-    double numb = CP_NUMBER_INVALID;
-    Cp_Opt opts[] = {
-        {&test, OPTK_BOOL, "test", 't', "Sick test."},
-        {&file, OPTK_STRING, "file", 0, "File to print.", "File which the program will print, whilst not removing its contents. Can be useful as a replacement for `cat`. Upon printing, exits the program successfully."},
-        {&name, OPTK_STRING, "name", 'n', "Your name.", "Prints your name to the terminal screen."},
-        {&numb, OPTK_NUMBER, "number", 'N', "Number to print."}
-    };
-
-    char *hi_name = NULL;
-    const char *scmd_hi_name = "hi";
-    Cp_Opt scmd_hi[] = {
-        {&hi_name, OPTK_STRING, "name", 'n'}
-    };
-
-    char *say_say = NULL;
-    const char *scmd_say_name = "say";
-    Cp_Opt scmd_say[] = {
-        {&say_say, OPTK_STRING, "name"}
-    };
-  
-    char **argumentv = alloca( argc * sizeof(char*));
-    Cp_Ctx *ctx = cp_newCtx(argc, argv, sizeof(opts)/sizeof(*opts), opts, argc, argumentv);
-    if(ctx == NULL) {
-        return 1;
-    }
-    
-    int stopped = 0;
-    const char *scmd_main[] = {scmd_hi_name, scmd_say_name};
-    if((stopped = cp_parseUntil(ctx, 2, scmd_main)) == -1) {
-        printf("ERROR: %s\n", ctx->err);
-        cp_freeCtx(ctx);
-        return 1;
-    }
+static bool test = false;
+static char *file = NULL;
+static char *name = NULL;
+static double numb = CP_NUMBER_INVALID;
+static char *hi_name = NULL;
+static char *say_say = NULL;
 
+// the options and arguments before the subcommand, printed whichever command runs
+static void print_main(int argumentc, char **argumentv) {
     if(test) {
         printf("This is a very sick test\n");
     }
@@ -77,58 +22,91 @@ int main(int argc, char *argv[]) {
     if(file != NULL) {
         printf("File name: %s\n", file);
     }
-    for(int i = 0; i < ctx->argumentc; ++i) {
-        printf("Argument[%d] = %s\n", i, ctx->argumentv[i]);
+    for(int i = 0; i < argumentc; ++i) {
+        printf("Argument[%d] = %s\n", i, argumentv[i]);
     }
+}
 
-    if(stopped == argc) {
-        printf("Success.\n");
-        cp_freeCtx(ctx);
-        return 0;
-    }
+static int run_main(Cp_Ctx *ctx, const Cp_Command *command) {
+    (void)command;
+    int argumentc;
+    char **argumentv = cp_commandArguments(ctx, &argumentc);
+    print_main(argumentc, argumentv);
+    printf("Success.\n");
+    return 0;
+}
 
-    if(cp__streq(argv[stopped], scmd_hi_name)) {
-        cp_freeCtx(ctx);
-        ctx = cp_newCtx(argc - stopped, argv + stopped, sizeof(scmd_hi)/sizeof(*scmd_hi), scmd_hi, 0, NULL);
-        if(ctx == NULL) {
-            return -1;
-        }
+// the arguments of the main command are the ones right before those of the subcommand
+static void print_parent(Cp_Ctx *ctx) {
+    int argumentc;
+    char **argumentv = cp_commandArguments(ctx, &argumentc);
+    print_main(ctx->command_argument, argumentv - ctx->command_argument);
+}
 
-        if(cp_parse(ctx) == -1) {
-            printf("ERROR: %s\n", ctx->err);
-            cp_freeCtx(ctx);
-            return -1;
-        }
+static int run_hi(Cp_Ctx *ctx, const Cp_Command *command) {
+    (void)command;
+    print_parent(ctx);
+    if(hi_name != NULL) {
+        printf("Hello, %s! ", hi_name);
+    }
+    printf("How are you doing today?\n");
+    return 0;
+}
 
-        if(hi_name != NULL) {
-            printf("Hello, %s! ", hi_name);
-        }
-        printf("How are you doing today?\n");
-    } else { // we can assume `scmd_say_name` here
-        printf("\n`say` started.\n\n");
-        cp_freeCtx(ctx);
+static int run_say(Cp_Ctx *ctx, const Cp_Command *command) {
+    (void)command;
+    print_parent(ctx);
+    printf("\n`say` started.\n\n");
+    if(say_say != NULL) {
+        printf("Hello, %s!\n", say_say);
+    }
+    int argumentc;
+    char **argumentv = cp_commandArguments(ctx, &argumentc);
+    for(int i = 0; i < argumentc; ++i) {
+        printf("Arg %d: %s\n", i + 1, argumentv[i]);
+    }
+    return 0;
+}
 
-        argumentv = alloca( (argc - stopped) * sizeof(char*));
-        ctx = cp_newCtx(argc - stopped, argv + stopped, sizeof(scmd_say)/sizeof(*scmd_say), scmd_say, argc - stopped, argumentv);
-        if(ctx == NULL) {
-            return -1;
-        }
+int main(int argc, char *argv[]) {
+    Cp_Opt opts[] = {
+        {&test, OPTK_BOOL, "test", 't', "Sick test."},
+        {&file, OPTK_STRING, "file", 0, "File to print.", .long_desc = "File which the program will print, whilst not removing its contents. Can be useful as a replacement for `cat`. Upon printing, exits the program successfully."},
+        {&name, OPTK_STRING, "name", 'n', "Your name.", .long_desc = "Prints your name to the terminal screen."},
+        {&numb, OPTK_NUMBER, "number", 'N', "Number to print."}
+    };
+    Cp_Opt scmd_hi[] = {
+        {&hi_name, OPTK_STRING, "name", 'n'}
+    };
+    Cp_Opt scmd_say[] = {
+        {&say_say, OPTK_STRING, "name"}
+    };
 
-        if(cp_parse(ctx) == -1) {
-            printf("ERROR: %s\n", ctx->err);
-            cp_freeCtx(ctx);
-            return -1;
-        }
+    // every level has its own options, parsed in one pass over argv with a single context
+    Cp_Command subcommands[] = {
+        {"hi", sizeof(scmd_hi)/sizeof(*scmd_hi), scmd_hi, .handler = run_hi},
+        {"say", sizeof(scmd_say)/sizeof(*scmd_say), scmd_say, .handler = run_say}
+    };
+    Cp_Command root = {NULL, sizeof(opts)/sizeof(*opts), opts, 2, subcommands, run_main};
 
-        if(say_say != NULL) {
-            printf("Hello, %s!\n", say_say);
-        }
-        for(int i = 1; i < ctx->argumentc; ++i) {
-            const char *arg = ctx->argumentv[i];
-            printf("Arg %d: %s\n", i, arg);
-        }
+    char **argumentv = alloca(argc * sizeof(char*));
+    Cp_Ctx ctx;
+    if(!cp_initCtx(&ctx, argc, argv, root.optc, root.optv, argc, argumentv)) {
+        return 1;
     }
 
-    cp_freeCtx(ctx);
-    return 0;
+    // `./example_subcommand __complete --n` answers shell completion instead of running
+    const char *scmd_main[] = {"hi", "say"};
+    if(cp_complete(&ctx, NULL, 2, scmd_main, stdout) >= 0) {
+        return 0;
+    }
+
+    int status = cp_runCommand(&ctx, &root);
+    if(status == -1 && ctx.err.code != CP_ERR_NONE) {
+        char err[256];
+        cp_formatError(&ctx, err, sizeof(err));
+        printf("ERROR: %s\n", err);
+        return 1;
+    }
+    return status;
 }
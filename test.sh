@@ -1,9 +1,31 @@
+compiler=clang
+flags="-fsanitize=address,undefined"
 if [ "$1" -eq "1" ]; then
     file=examples/example_simple.c
     elf=build/example_simple.elf
 elif [ "$1" -eq "2" ]; then
     file=examples/example_subcommand.c
     elf=build/example_subcommand.elf
+elif [ "$1" -eq "3" ]; then
+    file=examples/example_nomalloc.c
+    elf=build/example_nomalloc.elf
+    # AddressSanitizer replaces malloc, which would hide the example's own interposer
+    flags="-fsanitize=undefined"
+elif [ "$1" -eq "4" ]; then
+    # reads NUL-separated arguments from stdin, e.g. `printf '%s\0' -t --name bob a | ./test.sh 4`
+    file=examples/example_stream.c
+    elf=build/example_stream.elf
+elif [ "$1" -eq "5" ]; then
+    file=examples/example_cpp.cpp
+    elf=build/example_cpp.elf
+    compiler="clang++ -std=c++20"
+elif [ "$1" -eq "6" ]; then
+    # regression checks, prints OK when they all pass
+    file=tests/test_reset.c
+    elf=build/test_reset.elf
+elif [ "$1" -eq "7" ]; then
+    file=tests/test_commands.c
+    elf=build/test_commands.elf
 else 
     echo Which test to run?
     echo "Usage: $0 1 -- [ARGS]"
@@ -13,7 +35,7 @@ fi
 echo Building...
 mkdir -p build
 
-if clang -Wall -I. -o $elf -ggdb -fsanitize=address,undefined $file; then
+if $compiler -Wall -I. -o $elf -ggdb $flags $file; then
     true
 else 
     echo Build failed.
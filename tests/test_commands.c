@@ -0,0 +1,87 @@
+#define CLI_PARSER_IMPLEMENTATION
+#include "cli-parser.h"
+
+#include <stdio.h>
+
+// Walks into a subcommand with more options than the root's seen bits have room for, on heap and stack contexts,
+// and from a root with more options than the context was made for.
+// Run it through `./test.sh 7`.
+
+static int failures = 0;
+#define CHECK(cond) do { if(!(cond)) { printf("FAILED line %d: %s\n", __LINE__, #cond); ++failures; } } while(0)
+
+enum { ROOT_OPTS = 300, CHILD_OPTS = 600 };
+static Cp_Opt root_opts[ROOT_OPTS];
+static Cp_Opt child_opts[CHILD_OPTS];
+static char *child_values[CHILD_OPTS];
+static char names[ROOT_OPTS + CHILD_OPTS][16];
+static char envs[CHILD_OPTS][24];
+static bool root_flags[ROOT_OPTS];
+
+static void check_child(Cp_Ctx *ctx, const Cp_Command *root) {
+    char *env[] = {"TEST_OPT_550=from-env", "TEST_OPT_10=from-env", NULL};
+    memset(child_values, 0, sizeof(child_values));
+    const Cp_Command *command = cp_parseCommand(ctx, root);
+    CHECK(command == &root->subv[0]);
+    CHECK(cp_seen(ctx, 550));
+    CHECK(cp_seen(ctx, 10));
+    CHECK(!cp_seen(ctx, 11));
+    CHECK(cp_applyEnv(ctx, env));
+    // given on the command line, so the environment doesn't override them
+    CHECK(child_values[550] != NULL && strcmp(child_values[550], "cli") == 0);
+    CHECK(child_values[10] != NULL && strcmp(child_values[10], "cli") == 0);
+}
+
+int main(void) {
+    for(int i = 0; i < ROOT_OPTS; ++i) {
+        snprintf(names[i], sizeof(names[i]), "root-%d", i);
+        // `short_name` is const, so the fields are set one by one
+        root_opts[i].holder = &root_flags[i];
+        root_opts[i].kind = OPTK_BOOL;
+        root_opts[i].name = names[i];
+    }
+    for(int i = 0; i < CHILD_OPTS; ++i) {
+        snprintf(names[ROOT_OPTS + i], sizeof(names[0]), "opt-%d", i);
+        snprintf(envs[i], sizeof(envs[i]), "TEST_OPT_%d", i);
+        child_opts[i].holder = &child_values[i];
+        child_opts[i].kind = OPTK_STRING;
+        child_opts[i].name = names[ROOT_OPTS + i];
+        child_opts[i].env = envs[i];
+    }
+    Cp_Command child = {"child", CHILD_OPTS, child_opts};
+    Cp_Command root = {NULL, ROOT_OPTS, root_opts, 1, &child};
+    char *argv[] = {"prog", "--root-299", "child", "--opt-550=cli", "--opt-10", "cli"};
+    int argc = sizeof(argv)/sizeof(*argv);
+
+    // seen bits allocated by `cp_newCtx` for the root
+    Cp_Ctx *heap = cp_newCtx(argc, argv, ROOT_OPTS, root_opts, 0, NULL);
+    check_child(heap, &root);
+    // again on the same context, which keeps the grown bits
+    cp_resetCtx(heap, argc, argv);
+    check_child(heap, &root);
+    cp_freeCtx(heap);
+
+    // seen bits of the caller's own
+    uint64_t seen[CP_OPTION_WORDS(ROOT_OPTS)] = {0};
+    Cp_Ctx stack;
+    cp_initCtx(&stack, argc, argv, ROOT_OPTS, root_opts, 0, NULL);
+    stack.seen = seen;
+    check_child(&stack, &root);
+    cp_releaseCtx(&stack);
+
+    // seen bits sized for a single option, too few for the root itself
+    // on the heap, where AddressSanitizer catches a write past it
+    uint64_t *one = (uint64_t*)calloc(1, sizeof(uint64_t));
+    cp_initCtx(&stack, argc, argv, 1, root_opts, 0, NULL);
+    stack.seen = one;
+    check_child(&stack, &root);
+    CHECK(stack.seen_owned != NULL);
+    cp_releaseCtx(&stack);
+    free(one);
+
+    if(failures > 0) {
+        return 1;
+    }
+    printf("OK\n");
+    return 0;
+}
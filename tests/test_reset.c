@@ -0,0 +1,88 @@
+#define CLI_PARSER_IMPLEMENTATION
+#include "cli-parser.h"
+
+#include <stdio.h>
+
+// Parses, resets and parses bigger command lines on one context, with and without response files,
+// and checks that a reset forgets the last error.
+// Run it through `./test.sh 6`, AddressSanitizer catches bits written past the ones the context owns.
+
+static int failures = 0;
+#define CHECK(cond) do { if(!(cond)) { printf("FAILED line %d: %s\n", __LINE__, #cond); ++failures; } } while(0)
+
+static int count_arguments(const Cp_Ctx *ctx) {
+    int count = 0;
+    for(int i = cp_nextArgument(ctx, 0); i >= 0; i = cp_nextArgument(ctx, i+1)) {
+        ++count;
+    }
+    return count;
+}
+
+int main(void) {
+    const char *path = "build/test_reset.rsp";
+    FILE *file = fopen(path, "w");
+    if(file == NULL) {
+        printf("Could not write %s\n", path);
+        return 1;
+    }
+    fprintf(file, "-t rsp-a rsp-b\n");
+    fclose(file);
+    char at_path[64];
+    snprintf(at_path, sizeof(at_path), "@%s", path);
+
+    bool test = false;
+    Cp_Opt opts[] = {
+        {&test, OPTK_BOOL, "test", 't', "Test flag."}
+    };
+    // big enough for every argv below, as the caller would size it
+    enum { BIG = 300 };
+    uint64_t bits[CP_ARGUMENT_WORDS(BIG + 3)];
+    char *small[] = {"prog", at_path};
+    char *big[BIG + 1];
+    big[0] = "prog";
+    for(int i = 1; i < BIG; ++i) big[i] = "x";
+    big[BIG] = at_path;
+
+    Cp_Ctx ctx;
+    cp_initCtx(&ctx, 2, small, 1, opts, 0, NULL);
+    // no option is involved in an error yet
+    CHECK(ctx.err.opt == -1 && ctx.err.other == -1);
+    ctx.argument_bits = bits;
+    ctx.response_files = true;
+
+    // expansion switches to bits sized for 4 arguments
+    CHECK(cp_parse(&ctx) == 4);
+    CHECK(test);
+    CHECK(count_arguments(&ctx) == 3); // the program name counts too
+
+    // the caller's bits are back, even though this argv has no response file to expand
+    cp_resetCtx(&ctx, BIG, big);
+    CHECK(ctx.argument_bits == bits);
+    CHECK(cp_parse(&ctx) == BIG);
+    CHECK(count_arguments(&ctx) == BIG);
+
+    // and a bigger expansion gets bits of its own size
+    cp_resetCtx(&ctx, BIG + 1, big);
+    test = false;
+    CHECK(cp_parse(&ctx) == BIG + 3);
+    CHECK(test);
+    CHECK(count_arguments(&ctx) == BIG + 2);
+
+    // an error naming the option is forgotten by the next reset
+    char *bad[] = {"prog", "-t=1"};
+    cp_resetCtx(&ctx, 2, bad);
+    CHECK(cp_parse(&ctx) == -1);
+    CHECK(ctx.err.opt == 0);
+    cp_resetCtx(&ctx, 2, bad);
+    CHECK(ctx.err.code == CP_ERR_NONE && ctx.err.opt == -1 && ctx.err.other == -1);
+
+    cp_releaseCtx(&ctx);
+    CHECK(ctx.argument_bits == bits);
+    remove(path);
+
+    if(failures > 0) {
+        return 1;
+    }
+    printf("OK\n");
+    return 0;
+}
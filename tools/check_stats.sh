@@ -0,0 +1,33 @@
+#!/bin/sh
+# Checks that leaving CP_ENABLE_STATS undefined costs nothing: the implementation is compiled once as is
+# and once with every piece of instrumentation cut out of the header, and the machine code has to match.
+# `CFLAGS="-O3 -march=native" ./tools/check_stats.sh` checks other flags than the default -O2.
+
+set -e
+cd "$(dirname "$0")/.."
+mkdir -p build
+
+# drops `#ifdef CP_ENABLE_STATS` blocks (keeping their `#else` side) and the CP__STAT* statements
+awk '
+    skip == 0 && /^#ifdef CP_ENABLE_STATS/ { skip = 1; depth = 1; next }
+    skip != 0 && /^#if/    { ++depth; if(skip == 1) next }
+    skip != 0 && /^#endif/ { if(--depth == 0) { skip = 0; next } if(skip == 1) next }
+    skip != 0 && depth == 1 && /^#else/ { skip = 2; next }
+    skip == 1 { next }
+    /^[ \t]*CP__STAT[A-Z_]*\(/ { next }
+    { print }
+' cli-parser.h > build/cli-parser-nostats.h
+
+for header in cli-parser.h build/cli-parser-nostats.h; do
+    name=$(basename "$header" .h)
+    cc -O2 -w $CFLAGS -c -x c -DCLI_PARSER_IMPLEMENTATION -o "build/$name.o" "$header"
+    objdump -d --no-show-raw-insn "build/$name.o" | tail -n +4 > "build/$name.s"
+done
+
+if cmp -s build/cli-parser.s build/cli-parser-nostats.s; then
+    echo "OK: without CP_ENABLE_STATS the code is identical to the uninstrumented one."
+else
+    diff build/cli-parser-nostats.s build/cli-parser.s | head -40
+    echo "FAIL: the instrumentation leaks into the build without CP_ENABLE_STATS."
+    exit 1
+fi
@@ -0,0 +1,129 @@
+// Host tool writing a parser specialized for a fixed option table, see `cp_generateParser`.
+// The table comes from a schema file with one option per line, `#` starting a comment:
+//
+//     # long name   short name   kind
+//     name          n            string
+//     verbose       v            bool
+//     jobs          -            int64
+//
+// A `-` leaves the option without that name. Kinds are bool, number, string, int64, uint64, double,
+// string_list, number_list, enum and count, the choices of an enum stay in the program's own table.
+// The generated file keeps the schema order, which must match the `Cp_Opt` table of the program using it.
+// Programs can also call `cp_generateParser` with their own table instead.
+// E.g. `./cp_gen --prefix=app -o app_parser.c app.schema`
+
+#define CP_ENABLE_CODEGEN
+#define CLI_PARSER_IMPLEMENTATION
+#include "cli-parser.h"
+
+static const char *kind_names[] = {
+    [OPTK_BOOL] = "bool", [OPTK_NUMBER] = "number", [OPTK_STRING] = "string", [OPTK_INT64] = "int64",
+    [OPTK_UINT64] = "uint64", [OPTK_DOUBLE] = "double", [OPTK_STRING_LIST] = "string_list",
+    [OPTK_NUMBER_LIST] = "number_list", [OPTK_ENUM] = "enum", [OPTK_COUNT] = "count"
+};
+
+// Fills `optv` from the schema in `text`, which ends up holding the names. Returns the amount of options or -1.
+static int read_schema(char *text, size_t len, const char *path, int optcap, Cp_Opt optv[]) {
+    int optc = 0;
+    int line = 0;
+    char *at = text;
+    char *end = text + len;
+    while(at < end) {
+        ++line;
+        char *eol = memchr(at, '\n', (size_t)(end - at));
+        if(eol == NULL) eol = end;
+        char *hash = memchr(at, '#', (size_t)(eol - at));
+        char *stop = hash != NULL ? hash : eol;
+        char *words[4];
+        int wordc = cp_tokenize(at, (size_t)(stop - at), 4, words);
+        at = eol < end ? eol + 1 : end;
+        if(wordc == 0) continue;
+        if(wordc != 3) {
+            fprintf(stderr, "ERROR: %s:%d: Expected a long name, a short name and a kind.\n", path, line);
+            return -1;
+        }
+        if(optc == optcap) {
+            fprintf(stderr, "ERROR: %s:%d: More than %d options.\n", path, line, optcap);
+            return -1;
+        }
+        int kind = -1;
+        for(int k = 0; k < (int)(sizeof(kind_names)/sizeof(*kind_names)); ++k) {
+            if(cp__streq(words[2], kind_names[k])) kind = k;
+        }
+        if(kind < 0) {
+            fprintf(stderr, "ERROR: %s:%d: Unknown kind '%s'.\n", path, line, words[2]);
+            return -1;
+        }
+        char short_name = cp__streq(words[1], "-") ? '\0' : words[1][0];
+        if(short_name != '\0' && words[1][1] != '\0') {
+            fprintf(stderr, "ERROR: %s:%d: Short name '%s' is longer than a character.\n", path, line, words[1]);
+            return -1;
+        }
+        Cp_Opt opt = {NULL, (Cp_Opt_Kind)kind, cp__streq(words[0], "-") ? NULL : words[0], short_name};
+        memcpy(&optv[optc++], &opt, sizeof(opt));
+    }
+    return optc;
+}
+
+int main(int argc, char *argv[]) {
+    bool help = false;
+    char *prefix = "cp_generated";
+    char *output = NULL;
+    Cp_Opt opts[] = {
+        {&help, OPTK_BOOL, "help", 'h', "Prints this help message."},
+        {&prefix, OPTK_STRING, "prefix", 'p', "Start of the generated function names, `cp_generated` by default."},
+        {&output, OPTK_STRING, "output", 'o', "File to write, stdout by default."}
+    };
+    char *argumentv[3];
+    Cp_Ctx ctx;
+    if(!cp_initCtx(&ctx, argc, argv, sizeof(opts)/sizeof(*opts), opts, 3, argumentv)) {
+        return 1;
+    }
+    if(cp_parse(&ctx) == -1) {
+        char err[256];
+        cp_formatError(&ctx, err, sizeof(err));
+        fprintf(stderr, "ERROR: %s\n", err);
+        return 1;
+    }
+    if(help || ctx.argumentc != 2) {
+        printf("Usage: %s [OPTIONS] SCHEMA\n", argv[0]);
+        cp_usage(&ctx, stdout);
+        return help ? 0 : 1;
+    }
+
+    const char *path = ctx.argumentv[1];
+    FILE *file = fopen(path, "rb");
+    if(file == NULL) {
+        fprintf(stderr, "ERROR: Could not read '%s'.\n", path);
+        return 1;
+    }
+    static char text[1 << 20];
+    size_t len = fread(text, 1, sizeof(text) - 1, file);
+    bool whole = feof(file);
+    fclose(file);
+    if(!whole) {
+        fprintf(stderr, "ERROR: '%s' is bigger than %zu bytes.\n", path, sizeof(text) - 1);
+        return 1;
+    }
+
+    static Cp_Opt optv[1 << 14];
+    int optc = read_schema(text, len, path, sizeof(optv)/sizeof(*optv), optv);
+    if(optc < 0) {
+        return 1;
+    }
+
+    FILE *out = output != NULL ? fopen(output, "w") : stdout;
+    if(out == NULL) {
+        fprintf(stderr, "ERROR: Could not write '%s'.\n", output);
+        return 1;
+    }
+    bool ok = cp_generateParser(out, prefix, optc, optv);
+    if(out != stdout && fclose(out) != 0) {
+        ok = false;
+    }
+    if(!ok) {
+        fprintf(stderr, "ERROR: Could not generate the parser, check that the prefix is a C identifier and that no two options share a name.\n");
+        return 1;
+    }
+    return 0;
+}